@@ -17,20 +17,27 @@
 #include "types.h"
 #include "param.h"
 #include "spinlock.h"
+#include "rwlock.h"
 #include "sleeplock.h"
 #include "riscv.h"
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
 
+// bcache.lock, held for reading, is enough to find a cached
+// block and take or drop a reference (atomically); recycling
+// a buffer and reordering the list need it for writing.
 struct {
-  struct spinlock lock;
+  struct rwlock lock;
   struct buf buf[NBUF];
 
   // Linked list of all buffers, through prev/next.
   // Sorted by how recently the buffer was used.
   // head.next is most recent, head.prev is least.
   struct buf head;
+
+  uint64 nhit;
+  uint64 nmiss;
 } bcache;
 
 void
@@ -38,7 +45,7 @@ binit(void)
 {
   struct buf *b;
 
-  initlock(&bcache.lock, "bcache");
+  initrwlock(&bcache.lock, "bcache");
 
   // Create linked list of buffers
   bcache.head.prev = &bcache.head;
@@ -60,13 +67,25 @@ bget(uint dev, uint blockno)
 {
   struct buf *b;
 
-  acquire(&bcache.lock);
-
   // Is the block already cached?
+  acquireread(&bcache.lock);
+  for(b = bcache.head.next; b != &bcache.head; b = b->next){
+    if(b->dev == dev && b->blockno == blockno){
+      __sync_fetch_and_add(&b->refcnt, 1);
+      releaseread(&bcache.lock);
+      acquiresleep(&b->lock);
+      return b;
+    }
+  }
+  releaseread(&bcache.lock);
+
+  acquirewrite(&bcache.lock);
+
+  // Look again; it may have been read in meanwhile.
   for(b = bcache.head.next; b != &bcache.head; b = b->next){
     if(b->dev == dev && b->blockno == blockno){
       b->refcnt++;
-      release(&bcache.lock);
+      releasewrite(&bcache.lock);
       acquiresleep(&b->lock);
       return b;
     }
@@ -80,7 +99,7 @@ bget(uint dev, uint blockno)
       b->blockno = blockno;
       b->valid = 0;
       b->refcnt = 1;
-      release(&bcache.lock);
+      releasewrite(&bcache.lock);
       acquiresleep(&b->lock);
       return b;
     }
@@ -96,12 +115,22 @@ bread(uint dev, uint blockno)
 
   b = bget(dev, blockno);
   if(!b->valid) {
+    __atomic_fetch_add(&bcache.nmiss, 1, __ATOMIC_RELAXED);
     virtio_disk_rw(b, 0);
     b->valid = 1;
-  }
+  } else
+    __atomic_fetch_add(&bcache.nhit, 1, __ATOMIC_RELAXED);
   return b;
 }
 
+// how many bread()s found the block cached, and how many didn't.
+void
+bstats(uint64 *hit, uint64 *miss)
+{
+  *hit = bcache.nhit;
+  *miss = bcache.nmiss;
+}
+
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
@@ -121,7 +150,7 @@ brelse(struct buf *b)
 
   releasesleep(&b->lock);
 
-  acquire(&bcache.lock);
+  acquirewrite(&bcache.lock);
   b->refcnt--;
   if (b->refcnt == 0) {
     // no one is waiting for it.
@@ -133,21 +162,21 @@ brelse(struct buf *b)
     bcache.head.next = b;
   }
   
-  release(&bcache.lock);
+  releasewrite(&bcache.lock);
 }
 
 void
 bpin(struct buf *b) {
-  acquire(&bcache.lock);
-  b->refcnt++;
-  release(&bcache.lock);
+  acquireread(&bcache.lock);
+  __sync_fetch_and_add(&b->refcnt, 1);
+  releaseread(&bcache.lock);
 }
 
 void
 bunpin(struct buf *b) {
-  acquire(&bcache.lock);
-  b->refcnt--;
-  release(&bcache.lock);
+  acquireread(&bcache.lock);
+  __sync_fetch_and_sub(&b->refcnt, 1);
+  releaseread(&bcache.lock);
 }
 
 
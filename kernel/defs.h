@@ -1,13 +1,17 @@
 struct buf;
 struct context;
+struct dirent;
 struct file;
 struct inode;
 struct pipe;
 struct proc;
+struct rwlock;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct sysstat;
+struct tracerec;
 
 // bio.c
 void            binit(void);
@@ -16,6 +20,7 @@ void            brelse(struct buf*);
 void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
+void            bstats(uint64*, uint64*);
 
 // console.c
 void            consoleinit(void);
@@ -24,6 +29,14 @@ void            consputc(int);
 
 // exec.c
 int             exec(char*, char**);
+int             execproc(struct proc*, char*, char**);
+int             lazyfault(pagetable_t, uint64);
+void            lazytouch(uint64, uint64);
+
+// futex.c
+void            futexinit(void);
+int             futexwait(uint64, int);
+int             futexwake(uint64, int);
 
 // file.c
 struct file*    filealloc(void);
@@ -32,6 +45,7 @@ struct file*    filedup(struct file*);
 void            fileinit(void);
 int             fileread(struct file*, uint64, int n);
 int             filestat(struct file*, uint64 addr);
+int             filereaddir(struct file*, uint64, int n, int plus);
 int             filewrite(struct file*, uint64, int n);
 
 // fs.c
@@ -40,12 +54,14 @@ int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
 struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
+void            iexec(struct inode*, int);
 void            iinit();
 void            ilock(struct inode*);
 void            iput(struct inode*);
 void            iunlock(struct inode*);
 void            iunlockput(struct inode*);
 void            iupdate(struct inode*);
+struct inode*   dirnext(struct inode*, uint*, struct dirent*);
 int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
 struct inode*   nameiparent(char*, char*);
@@ -64,15 +80,22 @@ void*           kalloc(void);
 void            kfree(void *);
 void            kinit(void);
 uint64          kfreenum();
+uint64          ktotalnum();
 
 // log.c
 void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
 void            begin_op(void);
 void            end_op(void);
+uint64          logcommits(void);
+
+#ifdef MEMBENCH
+// membench.c
+void            membench(void);
+#endif
 
 // pipe.c
-int             pipealloc(struct file**, struct file**);
+int             pipealloc(struct file**, struct file**, int);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, uint64, int);
 int             pipewrite(struct pipe*, uint64, int);
@@ -80,12 +103,27 @@ int             pipewrite(struct pipe*, uint64, int);
 // printf.c
 void            printf(char*, ...);
 void            panic(char*) __attribute__((noreturn));
-void            printfinit(void);
+
+// sprintf.c
+int             snprintf(char*, int, char*, ...);
+
+// stats.c
+void            statsinit(void);
+
+// prof.c
+void            profinit(void);
+uint64          profdue(uint64);
+int             profstart(int);
+void            profsample(int, uint64, uint64, uint64);
+int             profread(uint64, int);
 
 // proc.c
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
+int             spawn(char*, char**, int*);
+void            kickidle(int);
+int             clone(uint64, uint64, uint64);
 int             growproc(int);
 void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
@@ -101,11 +139,14 @@ void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(uint64);
 void            wakeup(void*);
+void            wakeproc(struct proc*, void*);
+int             procsysstat(int, struct sysstat*);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
 uint64          procnum(void);
+uint64          procrunnable(void);
  
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -114,9 +155,19 @@ void            swtch(struct context*, struct context*);
 void            acquire(struct spinlock*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
+void            initmcslock(struct spinlock*, char*);
+void            freelock(struct spinlock*);
 void            release(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
+int             statslock(char*, int);
+
+// rwlock.c
+void            initrwlock(struct rwlock*, char*);
+void            acquireread(struct rwlock*);
+void            releaseread(struct rwlock*);
+void            acquirewrite(struct rwlock*);
+void            releasewrite(struct rwlock*);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
@@ -140,18 +191,31 @@ int             argaddr(int, uint64 *);
 int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
+void            syscallinit(void);
+int             sysstatread(int, int, uint64);
+
+// timer.c
+void            timersinit(void);
+void            timerarm(int);
+int             timerfire(void);
+void            timerslice(void);
+int             timersleep(uint64);
+
+// trace.c
+void            traceinit(void);
+void            tracerecord(struct tracerec*);
+int             traceread(uint64, int);
 
 // trap.c
-extern uint     ticks;
-void            trapinit(void);
 void            trapinithart(void);
-extern struct spinlock tickslock;
 void            usertrapret(void);
 
 // uart.c
 void            uartinit(void);
 void            uartintr(void);
-void            uartputc(int);
+void            uartwrite(char*, int);
+void            uartputs(char*, int);
+void            uartdrain(void);
 void            uartputc_sync(int);
 int             uartgetc(void);
 
@@ -181,10 +245,17 @@ void            plicinithart(void);
 int             plic_claim(void);
 void            plic_complete(int);
 
+// vdata.c
+void            vdatainit(void);
+void            vdatainithart(void);
+uint64          vdatapage(void);
+void            vdatatick(void);
+
 // virtio_disk.c
 void            virtio_disk_init(void);
 void            virtio_disk_rw(struct buf *, int);
 void            virtio_disk_intr(void);
+void            diskstats(uint64*, uint64*);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
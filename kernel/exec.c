@@ -7,19 +7,33 @@
 #include "defs.h"
 #include "elf.h"
 
-static int loadseg(pde_t *pgdir, uint64 addr, struct inode *ip, uint offset, uint sz);
-
 int
 exec(char *path, char **argv)
+{
+  struct proc *p = myproc();
+
+  // the group's other threads would be left running
+  // in the old image.
+  if(p->group != p || p->nthread > 0)
+    return -1;
+  return execproc(p, path, argv);
+}
+
+// Replace p's user image with the program at path.
+// p is either the caller (exec) or a new process that
+// spawn() has allocated but not yet made runnable.
+// Returns argc, which the caller arranges to pass in a0.
+int
+execproc(struct proc *p, char *path, char **argv)
 {
   char *s, *last;
-  int i, off;
+  int i, off, nseg = 0;
   uint64 argc, sz = 0, sp, ustack[MAXARG], stackbase;
   struct elfhdr elf;
-  struct inode *ip;
+  struct inode *ip, *exe = 0, *oldexe;
   struct proghdr ph;
+  struct vmseg seg[NSEG];
   pagetable_t pagetable = 0, oldpagetable;
-  struct proc *p = myproc();
 
   begin_op();
 
@@ -38,7 +52,9 @@ exec(char *path, char **argv)
   if((pagetable = proc_pagetable(p)) == 0)
     goto bad;
 
-  // Load program into memory.
+  // Record the program segments. Nothing is read yet;
+  // lazyfault() pages each one in from the executable
+  // the first time the program touches it.
   for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
     if(readi(ip, 0, (uint64)&ph, off, sizeof(ph)) != sizeof(ph))
       goto bad;
@@ -48,20 +64,29 @@ exec(char *path, char **argv)
       goto bad;
     if(ph.vaddr + ph.memsz < ph.vaddr)
       goto bad;
-    uint64 sz1;
-    if((sz1 = uvmalloc(pagetable, sz, ph.vaddr + ph.memsz)) == 0)
+    if(ph.vaddr + ph.memsz >= MAXUSER)
       goto bad;
-    sz = sz1;
     if((ph.vaddr % PGSIZE) != 0)
       goto bad;
-    if(loadseg(pagetable, ph.vaddr, ip, ph.off, ph.filesz) < 0)
+    if(ph.off + ph.filesz < ph.off)
       goto bad;
+    if(nseg >= NSEG)
+      goto bad;
+    seg[nseg].va = ph.vaddr;
+    seg[nseg].memsz = ph.memsz;
+    seg[nseg].filesz = ph.filesz;
+    seg[nseg].off = ph.off;
+    nseg++;
+    if(ph.vaddr + ph.memsz > sz)
+      sz = ph.vaddr + ph.memsz;
   }
-  iunlockput(ip);
+
+  // Keep the reference to ip; the segments are read from it.
+  iunlock(ip);
   end_op();
+  exe = ip;
   ip = 0;
 
-  p = myproc();
   uint64 oldsz = p->sz;
 
   // Allocate two pages at the next page boundary.
@@ -110,11 +135,22 @@ exec(char *path, char **argv)
     
   // Commit to the user image.
   oldpagetable = p->pagetable;
+  oldexe = p->exe;
   p->pagetable = pagetable;
   p->sz = sz;
+  p->exe = exe;
+  iexec(exe, 1);
+  memmove(p->seg, seg, sizeof(seg));
+  p->nseg = nseg;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
   proc_freepagetable(oldpagetable, oldsz);
+  if(oldexe){
+    iexec(oldexe, -1);
+    begin_op();
+    iput(oldexe);
+    end_op();
+  }
 
 
   if(p->pid == 1) {
@@ -130,30 +166,103 @@ exec(char *path, char **argv)
     iunlockput(ip);
     end_op();
   }
+  if(exe){
+    begin_op();
+    iput(exe);
+    end_op();
+  }
   return -1;
 }
 
-// Load a program segment into pagetable at virtual address va.
-// va must be page-aligned
-// and the pages from va to va+sz must already be mapped.
-// Returns 0 on success, -1 on failure.
-static int
-loadseg(pagetable_t pagetable, uint64 va, struct inode *ip, uint offset, uint sz)
+// Map the page containing va if it is part of one of the
+// current process's lazily loaded program segments, reading
+// it from p->exe and zero-filling whatever lies past filesz.
+// This can happen long after exec(), so open() refuses to
+// write or truncate a file while a process runs it (like
+// ETXTBSY). It doesn't stop exec() of a file that is already
+// open for writing; such a program may see the later writes.
+// Called for user page faults and by copyin()/copyout().
+// Returns 0 if the page is now mapped, -1 if va is not a
+// lazy page (or is already mapped) or memory ran out.
+int
+lazyfault(pagetable_t pagetable, uint64 va)
 {
-  uint i, n;
-  uint64 pa;
-
-  for(i = 0; i < sz; i += PGSIZE){
-    pa = walkaddr(pagetable, va + i);
-    if(pa == 0)
-      panic("loadseg: address should exist");
-    if(sz - i < PGSIZE)
-      n = sz - i;
-    else
+  struct proc *p = myproc();
+  struct vmseg *s;
+  pte_t *pte;
+  uint64 off, n;
+  char *mem;
+  int r;
+
+  if(p == 0 || p->pagetable != pagetable)
+    return -1;
+  p = p->group;
+  if(va >= p->sz)
+    return -1;
+  va = PGROUNDDOWN(va);
+
+  // already mapped, e.g. the stack guard page.
+  if((pte = walk(pagetable, va, 0)) != 0 && (*pte & PTE_V))
+    return -1;
+
+  for(s = p->seg; s < &p->seg[p->nseg]; s++)
+    if(va >= s->va && va < s->va + s->memsz)
+      break;
+  if(s == &p->seg[p->nseg])
+    return -1;
+
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+
+  off = va - s->va;
+  if(off < s->filesz){
+    // readi() may sleep, so no spinlock can be held here.
+    // Callers that copy to user memory under a spinlock
+    // must lazytouch() the range first.
+    if(intr_get() == 0)
+      panic("lazyfault: interrupts off");
+    n = s->filesz - off;
+    if(n > PGSIZE)
       n = PGSIZE;
-    if(readi(ip, 0, (uint64)pa, offset+i, n) != n)
+    ilock(p->exe);
+    if(readi(p->exe, 0, (uint64)mem, s->off + off, n) != n){
+      iunlock(p->exe);
+      kfree(mem);
       return -1;
+    }
+    iunlock(p->exe);
+  }
+
+  // another thread of the group may have mapped the
+  // page while we were reading it.
+  acquire(&p->glock);
+  if((pte = walk(pagetable, va, 0)) != 0 && (*pte & PTE_V))
+    r = 1;
+  else
+    r = mappages(pagetable, va, PGSIZE, (uint64)mem, PTE_W|PTE_X|PTE_R|PTE_U);
+  release(&p->glock);
+  if(r != 0){
+    kfree(mem);
+    return r > 0 ? 0 : -1;
   }
-  
   return 0;
 }
+
+// Fault in any lazily loaded pages of the current process
+// in [va, va+len), for callers that are about to copy to or
+// from user memory while holding a spinlock or an inode lock.
+void
+lazytouch(uint64 va, uint64 len)
+{
+  struct proc *p = myproc()->group;
+  uint64 a;
+
+  if(len == 0 || va >= p->sz)
+    return;
+  if(va + len > p->sz || va + len < va)
+    len = p->sz - va;
+  for(a = PGROUNDDOWN(va); a < va + len; a += PGSIZE)
+    if(walkaddr(p->pagetable, a) == 0)
+      lazyfault(p->pagetable, a);
+}
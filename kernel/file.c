@@ -101,6 +101,69 @@ filestat(struct file *f, uint64 addr)
   return -1;
 }
 
+// Read directory f's next entries to user address addr,
+// as many as fit in n bytes: struct tdirents, or if plus,
+// struct direntpluses, which add each inode's size.
+// Returns the number of bytes, 0 at the end.
+int
+filereaddir(struct file *f, uint64 addr, int n, int plus)
+{
+  struct inode *dp = f->ip, *ip;
+  struct dirent de;
+  struct direntplus dx;
+  struct tdirent td;
+  struct stat st;
+  int sz, tot, removed;
+  void *rec;
+
+  if(f->type != FD_INODE || f->readable == 0 || dp->type != T_DIR)
+    return -1;
+  sz = plus ? sizeof(dx) : sizeof(td);
+  rec = plus ? (void*)&dx : (void*)&td;
+  lazytouch(addr, n);
+  for(tot = 0; tot + sz <= n; tot += sz){
+    ilock(dp);
+    ip = dirnext(dp, &f->off, &de);
+    if(ip == dp)
+      stati(dp, &st);
+    removed = dp->nlink == 0;
+    iunlock(dp);
+    if(ip == 0)
+      break;
+    begin_op();
+    if(ip == dp){
+      // . was done above.
+    } else if(namecmp(de.name, "..") == 0 && (!plus || removed)){
+      // a directory; no need to look unless asked for
+      // the size. The parent of a removed directory may
+      // be gone, though, so don't.
+      st.type = T_DIR;
+      st.size = 0;
+    } else {
+      // dirnext()'s reference keeps the inode from being
+      // freed by an unlink() since dp was unlocked.
+      ilock(ip);
+      stati(ip, &st);
+      iunlock(ip);
+    }
+    iput(ip);
+    end_op();
+    if(plus){
+      dx.inum = de.inum;
+      dx.type = st.type;
+      dx.size = st.size;
+      memmove(dx.name, de.name, DIRSIZ);
+    } else {
+      td.inum = de.inum;
+      td.type = st.type;
+      memmove(td.name, de.name, DIRSIZ);
+    }
+    if(either_copyout(1, addr + tot, rec, sz) < 0)
+      return -1;
+  }
+  return tot;
+}
+
 // Read from file f.
 // addr is a user virtual address.
 int
@@ -118,6 +181,9 @@ fileread(struct file *f, uint64 addr, int n)
       return -1;
     r = devsw[f->major].read(1, addr, n);
   } else if(f->type == FD_INODE){
+    // fault in lazy exec pages before taking the inode lock,
+    // since paging one in locks the executable's inode.
+    lazytouch(addr, n);
     ilock(f->ip);
     if((r = readi(f->ip, 1, addr, f->off, n)) > 0)
       f->off += r;
@@ -154,6 +220,7 @@ filewrite(struct file *f, uint64 addr, int n)
     // might be writing a device like the console.
     int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
     int i = 0;
+    lazytouch(addr, n);
     while(i < n){
       int n1 = n - i;
       if(n1 > max)
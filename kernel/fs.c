@@ -15,6 +15,7 @@
 #include "param.h"
 #include "stat.h"
 #include "spinlock.h"
+#include "rwlock.h"
 #include "proc.h"
 #include "sleeplock.h"
 #include "fs.h"
@@ -162,17 +163,20 @@ bfree(int dev, uint b)
 // have locked the inodes involved; this lets callers create
 // multi-step atomic operations.
 //
-// The itable.lock spin-lock protects the allocation of itable
-// entries. Since ip->ref indicates whether an entry is free,
+// The itable.lock reader-writer lock protects the allocation of
+// itable entries. Since ip->ref indicates whether an entry is free,
 // and ip->dev and ip->inum indicate which i-node an entry
 // holds, one must hold itable.lock while using any of those fields.
+// Holding it for reading is enough to look entries up and to
+// increment ip->ref atomically (iget() hits, idup()); anything
+// that can free or recycle an entry must hold it for writing.
 //
 // An ip->lock sleep-lock protects all ip-> fields other than ref,
 // dev, and inum.  One must hold ip->lock in order to
 // read or write that inode's ip->valid, ip->size, ip->type, &c.
 
 struct {
-  struct spinlock lock;
+  struct rwlock lock;
   struct inode inode[NINODE];
 } itable;
 
@@ -181,7 +185,7 @@ iinit()
 {
   int i = 0;
   
-  initlock(&itable.lock, "itable");
+  initrwlock(&itable.lock, "itable");
   for(i = 0; i < NINODE; i++) {
     initsleeplock(&itable.inode[i].lock, "inode");
   }
@@ -244,14 +248,27 @@ iget(uint dev, uint inum)
 {
   struct inode *ip, *empty;
 
-  acquire(&itable.lock);
+  // Is the inode already in the table? Readers on other
+  // harts can look at the same time.
+  acquireread(&itable.lock);
+  for(ip = &itable.inode[0]; ip < &itable.inode[NINODE]; ip++){
+    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
+      __sync_fetch_and_add(&ip->ref, 1);
+      releaseread(&itable.lock);
+      return ip;
+    }
+  }
+  releaseread(&itable.lock);
 
-  // Is the inode already in the table?
+  acquirewrite(&itable.lock);
+
+  // Look again, since another process may have
+  // added it in between.
   empty = 0;
   for(ip = &itable.inode[0]; ip < &itable.inode[NINODE]; ip++){
     if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
       ip->ref++;
-      release(&itable.lock);
+      releasewrite(&itable.lock);
       return ip;
     }
     if(empty == 0 && ip->ref == 0)    // Remember empty slot.
@@ -267,7 +284,7 @@ iget(uint dev, uint inum)
   ip->inum = inum;
   ip->ref = 1;
   ip->valid = 0;
-  release(&itable.lock);
+  releasewrite(&itable.lock);
 
   return ip;
 }
@@ -277,12 +294,22 @@ iget(uint dev, uint inum)
 struct inode*
 idup(struct inode *ip)
 {
-  acquire(&itable.lock);
-  ip->ref++;
-  release(&itable.lock);
+  acquireread(&itable.lock);
+  __sync_fetch_and_add(&ip->ref, 1);
+  releaseread(&itable.lock);
   return ip;
 }
 
+// Count one more (n = 1) or one fewer (n = -1) process
+// running ip. Such a process's pages are read in from ip as
+// they are touched (see lazyfault()), so open() won't let
+// ip be written or truncated while any is.
+void
+iexec(struct inode *ip, int n)
+{
+  __sync_fetch_and_add(&ip->nexec, n);
+}
+
 // Lock the given inode.
 // Reads the inode from disk if necessary.
 void
@@ -332,7 +359,7 @@ iunlock(struct inode *ip)
 void
 iput(struct inode *ip)
 {
-  acquire(&itable.lock);
+  acquirewrite(&itable.lock);
 
   if(ip->ref == 1 && ip->valid && ip->nlink == 0){
     // inode has no links and no other references: truncate and free.
@@ -341,7 +368,7 @@ iput(struct inode *ip)
     // so this acquiresleep() won't block (or deadlock).
     acquiresleep(&ip->lock);
 
-    release(&itable.lock);
+    releasewrite(&itable.lock);
 
     itrunc(ip);
     ip->type = 0;
@@ -350,11 +377,11 @@ iput(struct inode *ip)
 
     releasesleep(&ip->lock);
 
-    acquire(&itable.lock);
+    acquirewrite(&itable.lock);
   }
 
   ip->ref--;
-  release(&itable.lock);
+  releasewrite(&itable.lock);
 }
 
 // Common idiom: unlock, then put.
@@ -552,6 +579,28 @@ dirlookup(struct inode *dp, char *name, uint *poff)
   return 0;
 }
 
+// Copy directory dp's first entry at or after *off into de,
+// move *off past it, and return the (unlocked) inode it names,
+// as dirlookup() does; 0 if there are no more. Caller must
+// hold dp->lock, so the entry can't be unlinked and its inode
+// freed before the reference is taken.
+struct inode*
+dirnext(struct inode *dp, uint *off, struct dirent *de)
+{
+  if(dp->type != T_DIR)
+    panic("dirnext not DIR");
+
+  for(; *off < dp->size; *off += sizeof(*de)){
+    if(readi(dp, 0, (uint64)de, *off, sizeof(*de)) != sizeof(*de))
+      panic("dirnext read");
+    if(de->inum != 0){
+      *off += sizeof(*de);
+      return iget(dp->dev, de->inum);
+    }
+  }
+  return 0;
+}
+
 // Write a new directory entry (name, inum) into the directory dp.
 int
 dirlink(struct inode *dp, char *name, uint inum)
@@ -633,7 +682,7 @@ namex(char *path, int nameiparent, char *name)
   if(*path == '/')
     ip = iget(ROOTDEV, ROOTINO);
   else
-    ip = idup(myproc()->cwd);
+    ip = idup(myproc()->group->cwd);
 
   while((path = skipelem(path, name)) != 0){
     ilock(ip);
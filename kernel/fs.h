@@ -58,3 +58,19 @@ struct dirent {
   char name[DIRSIZ];
 };
 
+// getdents() returns these: a directory entry
+// along with the type of the inode it names.
+struct tdirent {
+  ushort inum;
+  short type;
+  char name[DIRSIZ];
+};
+
+// readdirplus() returns these, which add the size.
+struct direntplus {
+  ushort inum;
+  short type;
+  uint size;
+  char name[DIRSIZ];
+};
+
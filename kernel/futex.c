@@ -0,0 +1,129 @@
+// Futexes: let user threads block on a word of memory.
+//
+// futexwait(addr, val) sleeps as long as *addr == val, until a
+// futexwake(addr, n) on the same word. Waiters are keyed by the
+// physical address of the word, so any two mappings of the same
+// page (threads of a group, or processes sharing memory) meet.
+//
+// Each waiter is a struct on its own kernel stack, linked into
+// one of NFUTEX hash buckets. The bucket lock covers both the
+// check of *addr and the enqueue, so a wake that follows a
+// store to the word can't slip in between and be lost.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+#define NFUTEX 61
+
+struct futexwaiter {
+  uint64 pa;                  // physical address waited on
+  int woken;
+  struct futexwaiter *next;
+};
+
+struct {
+  struct spinlock lock;
+  struct futexwaiter *head;
+} futextab[NFUTEX];
+
+void
+futexinit(void)
+{
+  for(int i = 0; i < NFUTEX; i++)
+    initlock(&futextab[i].lock, "futex");
+}
+
+// physical address of the user word at addr, or 0.
+static uint64
+futexaddr(uint64 addr)
+{
+  uint64 pa;
+
+  if(addr % sizeof(int) != 0)
+    return 0;
+  lazytouch(addr, sizeof(int));
+  if((pa = walkaddr(myproc()->pagetable, addr)) == 0)
+    return 0;
+  return pa + (addr % PGSIZE);
+}
+
+static int
+futexhash(uint64 pa)
+{
+  return (pa / sizeof(int)) % NFUTEX;
+}
+
+// Sleep until woken by futexwake(addr) if *addr == val.
+// Returns 0 if woken, -1 if *addr != val, addr is bad,
+// or the process was killed.
+int
+futexwait(uint64 addr, int val)
+{
+  struct futexwaiter w, **pp;
+  struct proc *p = myproc();
+  uint64 pa;
+  int h;
+
+  if((pa = futexaddr(addr)) == 0)
+    return -1;
+  h = futexhash(pa);
+
+  acquire(&futextab[h].lock);
+  if(*(volatile int*)pa != val){
+    release(&futextab[h].lock);
+    return -1;
+  }
+  // append, so that wakeups go to the longest waiter.
+  w.pa = pa;
+  w.woken = 0;
+  w.next = 0;
+  for(pp = &futextab[h].head; *pp; pp = &(*pp)->next)
+    ;
+  *pp = &w;
+
+  while(!w.woken && !p->killed)
+    sleep(&w, &futextab[h].lock);
+
+  if(!w.woken){
+    for(pp = &futextab[h].head; *pp != &w; pp = &(*pp)->next)
+      ;
+    *pp = w.next;
+  }
+  release(&futextab[h].lock);
+  return w.woken ? 0 : -1;
+}
+
+// Wake up to n threads waiting on addr.
+// Returns the number woken, or -1 if addr is bad.
+int
+futexwake(uint64 addr, int n)
+{
+  struct futexwaiter *w, **pp;
+  uint64 pa;
+  int h, nwoken = 0;
+
+  if((pa = futexaddr(addr)) == 0)
+    return -1;
+  h = futexhash(pa);
+
+  acquire(&futextab[h].lock);
+  pp = &futextab[h].head;
+  while(*pp && nwoken < n){
+    w = *pp;
+    if(w->pa != pa){
+      pp = &w->next;
+      continue;
+    }
+    *pp = w->next;
+    w->woken = 1;
+    wakeup(w);
+    nwoken++;
+  }
+  release(&futextab[h].lock);
+  return nwoken;
+}
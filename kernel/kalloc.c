@@ -21,13 +21,16 @@ struct run {
 struct {
   struct spinlock lock;
   struct run *freelist;
+  uint64 nfree;    // pages on freelist
+  uint64 ntotal;   // pages handed to kfree() by kinit()
 } kmem;
 
 void
 kinit()
 {
-  initlock(&kmem.lock, "kmem");
+  initmcslock(&kmem.lock, "kmem");
   freerange(end, (void*)PHYSTOP);
+  kmem.ntotal = kmem.nfree;
 }
 
 void
@@ -59,6 +62,7 @@ kfree(void *pa)
   acquire(&kmem.lock);
   r->next = kmem.freelist;
   kmem.freelist = r;
+  kmem.nfree++;
   release(&kmem.lock);
 }
 
@@ -72,8 +76,10 @@ kalloc(void)
 
   acquire(&kmem.lock);
   r = kmem.freelist;
-  if(r)
+  if(r){
     kmem.freelist = r->next;
+    kmem.nfree--;
+  }
   release(&kmem.lock);
 
   if(r)
@@ -81,15 +87,16 @@ kalloc(void)
   return (void*)r;
 }
 
-uint64 
+// bytes of free memory.
+uint64
 kfreenum()
 {
-  uint64 num = 0;
-  struct run *head = kmem.freelist;
-  
-  while(head) {
-    num += PGSIZE;
-    head = head->next;
-  }
-  return num;
+  return kmem.nfree * PGSIZE;
+}
+
+// bytes of memory the allocator manages.
+uint64
+ktotalnum()
+{
+  return kmem.ntotal * PGSIZE;
 }
\ No newline at end of file
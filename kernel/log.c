@@ -45,6 +45,7 @@ struct log {
   int committing;  // in commit(), please wait.
   int dev;
   struct logheader lh;
+  uint64 ncommit;  // transactions committed
 };
 struct log log;
 
@@ -199,9 +200,16 @@ commit()
     install_trans(0); // Now install writes to home locations
     log.lh.n = 0;
     write_head();    // Erase the transaction from the log
+    log.ncommit++;
   }
 }
 
+uint64
+logcommits(void)
+{
+  return log.ncommit;
+}
+
 // Caller has modified b->data and is done with the buffer.
 // Record the block number and pin in the cache by increasing refcnt.
 // commit()/write_log() will do the disk write.
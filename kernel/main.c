@@ -12,7 +12,6 @@ main()
 {
   if(cpuid() == 0){
     consoleinit();
-    printfinit();
     printf("\n");
     printf("xv6 kernel is booting\n");
     printf("\n");
@@ -20,14 +19,24 @@ main()
     kvminit();       // create kernel page table
     kvminithart();   // turn on paging
     procinit();      // process table
-    trapinit();      // trap vectors
+    vdatainit();     // page shared with user space
+    timersinit();    // timer deadlines
     trapinithart();  // install kernel trap vector
+    vdatainithart(); // user access to counters
     plicinit();      // set up interrupt controller
     plicinithart();  // ask PLIC for device interrupts
     binit();         // buffer cache
     iinit();         // inode table
     fileinit();      // file table
+    statsinit();     // statistics device
+    futexinit();     // futex wait queues
+    traceinit();     // syscall trace rings
+    syscallinit();   // syscall statistics
+    profinit();      // sampling profiler
     virtio_disk_init(); // emulated hard disk
+#ifdef MEMBENCH
+    membench();      // time memset/memmove/memcmp
+#endif
     userinit();      // first user process
     __sync_synchronize();
     started = 1;
@@ -38,6 +47,7 @@ main()
     printf("hart %d starting\n", cpuid());
     kvminithart();    // turn on paging
     trapinithart();   // install kernel trap vector
+    vdatainithart();  // user access to counters
     plicinithart();   // ask PLIC for device interrupts
   }
 
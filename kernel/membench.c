@@ -0,0 +1,70 @@
+// Boot-time microbenchmark of memset(), memmove() and memcmp()
+// (make MEMBENCH=1). Prints bytes per cycle, times 100, for
+// each size class, with the destination aligned and then
+// misaligned by 3 bytes. Whole aligned pages take the page
+// fast paths in string.c.
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "defs.h"
+
+#define TOTAL (1024*1024)  // bytes handled per measurement
+#define OFF 3
+
+static int sizes[] = { 8, 64, 512, 2048, PGSIZE };
+static char *names[] = { "memset", "memmove", "memcmp" };
+
+static char *a, *b;
+
+// bytes/cycle * 100 for n-byte operations on a+off.
+static int
+timeit(int op, int n, int off)
+{
+  uint64 t0, t;
+  int i, iters = TOTAL / n;
+
+  if(op == 2){
+    // b matches a+off except for its last byte,
+    // so memcmp() has to look at everything.
+    memmove(b, a + off, n);
+    b[n-1] = a[off+n-1] + 1;
+  }
+
+  t0 = r_cycle();
+  for(i = 0; i < iters; i++){
+    if(op == 0)
+      memset(a + off, i, n);
+    else if(op == 1)
+      memmove(a + off, b, n);
+    else if(memcmp(a + off, b, n) == 0)
+      panic("membench: memcmp");
+  }
+  t = r_cycle() - t0;
+  if(t == 0)
+    t = 1;
+  return (uint64)iters * n * 100 / t;
+}
+
+void
+membench(void)
+{
+  int op, i, n;
+
+  if((a = kalloc()) == 0 || (b = kalloc()) == 0)
+    panic("membench: kalloc");
+  memset(b, 1, PGSIZE);
+
+  printf("membench: bytes/cycle x100, aligned / misaligned\n");
+  for(op = 0; op < NELEM(names); op++){
+    for(i = 0; i < NELEM(sizes); i++){
+      n = sizes[i];
+      printf("%s %d: %d", names[op], n, timeit(op, n, 0));
+      if(n + OFF > PGSIZE)
+        n = PGSIZE - OFF;
+      printf(" / %d\n", timeit(op, n, OFF));
+    }
+  }
+  kfree(a);
+  kfree(b);
+}
@@ -33,6 +33,8 @@
 #define CLINT 0x2000000L
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
+#define TIMEFREQ 10000000L     // mtime (the time CSR) ticks at 10MHz in qemu.
+#define TICKCYCLES 1000000L    // a scheduling tick, 1/10th second.
 
 // qemu puts platform-level interrupt controller (PLIC) here.
 #define PLIC 0x0c000000L
@@ -66,14 +68,43 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   ...
+//   THREADFRAME(i) (trapframes of clone()d threads)
+//   VDATA (kernel data shared with all processes)
 //   USYSCALL (shared with kernel)
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
 #ifdef LAB_PGTBL
 #define USYSCALL (TRAPFRAME - PGSIZE)
+#define VDATA (USYSCALL - PGSIZE)
+
+// threads share their group's page table, so each needs its
+// own trapframe address; proc[i] uses THREADFRAME(i).
+// user memory must stay below all of them.
+#define THREADFRAME(i) (VDATA - ((i)+1)*PGSIZE)
+#define MAXUSER THREADFRAME(NPROC)
 
 struct usyscall {
   int pid;  // Process ID
+  int cpu;  // hart it last ran on (for a thread group, any member)
+};
+
+// the page at VDATA, the same one in every process, so that
+// user/ulib.c can answer uptime() and clock_gettime() without
+// a trap. the kernel increments seq before and after each
+// update, so a reader that saw it odd, or saw it change, must
+// read again.
+#define VDATA_VERSION 1
+
+struct vdata {
+  uint version;      // VDATA_VERSION
+  uint seq;
+  uint64 ticks;      // uptime() when the time CSR read stamp
+  uint64 stamp;
+  uint64 tickcycles; // time CSR ticks per uptime() tick
+  uint64 timebase;   // time CSR reading at clock_gettime() 0
+  uint64 timefreq;   // time CSR ticks per second
+  int ncpu;          // harts running
 };
 #endif
@@ -9,32 +9,65 @@
 #include "file.h"
 
 #define PIPESIZE 512
+#define MAXPIPEPG 16    // pages in the biggest pipe
 
+// A pipe's buffer is data, or for a bigger pipe, a power
+// of two of separately allocated pages. Either way size
+// divides 2^32, so nread and nwrite can wrap.
 struct pipe {
   struct spinlock lock;
-  char data[PIPESIZE];
+  uint size;      // buffer bytes
   uint nread;     // number of bytes read
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  char *page[MAXPIPEPG];
+  char data[PIPESIZE];
 };
 
+static void
+pipefree(struct pipe *pi)
+{
+  int i;
+
+  for(i = 0; i < MAXPIPEPG; i++)
+    if(pi->page[i])
+      kfree(pi->page[i]);
+  freelock(&pi->lock);
+  kfree((char*)pi);
+}
+
+// Make a pipe holding at least size bytes, or the
+// default PIPESIZE if size is smaller.
 int
-pipealloc(struct file **f0, struct file **f1)
+pipealloc(struct file **f0, struct file **f1, int size)
 {
   struct pipe *pi;
+  int i, npg;
 
+  if(size > MAXPIPEPG * PGSIZE)
+    return -1;
   pi = 0;
   *f0 = *f1 = 0;
   if((*f0 = filealloc()) == 0 || (*f1 = filealloc()) == 0)
     goto bad;
   if((pi = (struct pipe*)kalloc()) == 0)
     goto bad;
+  initlock(&pi->lock, "pipe");
+  memset(pi->page, 0, sizeof(pi->page));
+  pi->size = PIPESIZE;
+  if(size > PIPESIZE){
+    for(npg = 1; npg * PGSIZE < size; npg *= 2)
+      ;
+    for(i = 0; i < npg; i++)
+      if((pi->page[i] = kalloc()) == 0)
+        goto bad;
+    pi->size = npg * PGSIZE;
+  }
   pi->readopen = 1;
   pi->writeopen = 1;
   pi->nwrite = 0;
   pi->nread = 0;
-  initlock(&pi->lock, "pipe");
   (*f0)->type = FD_PIPE;
   (*f0)->readable = 1;
   (*f0)->writable = 0;
@@ -47,7 +80,7 @@ pipealloc(struct file **f0, struct file **f1)
 
  bad:
   if(pi)
-    kfree((char*)pi);
+    pipefree(pi);
   if(*f0)
     fileclose(*f0);
   if(*f1)
@@ -68,32 +101,55 @@ pipeclose(struct pipe *pi, int writable)
   }
   if(pi->readopen == 0 && pi->writeopen == 0){
     release(&pi->lock);
-    kfree((char*)pi);
+    pipefree(pi);
   } else
     release(&pi->lock);
 }
 
+// Where byte off of the pipe's stream is in its buffer,
+// and in *n, how many bytes follow it there contiguously.
+static char*
+pipebuf(struct pipe *pi, uint off, uint *n)
+{
+  off %= pi->size;
+  if(pi->size == PIPESIZE){
+    *n = PIPESIZE - off;
+    return pi->data + off;
+  }
+  *n = PGSIZE - off % PGSIZE;
+  return pi->page[off / PGSIZE] + off % PGSIZE;
+}
+
+// Copy in as much at a time as fits before the
+// buffer wraps or a page of it ends.
 int
 pipewrite(struct pipe *pi, uint64 addr, int n)
 {
   int i = 0;
+  uint m;
+  char *p;
   struct proc *pr = myproc();
 
+  lazytouch(addr, n);
   acquire(&pi->lock);
   while(i < n){
     if(pi->readopen == 0 || pr->killed){
       release(&pi->lock);
       return -1;
     }
-    if(pi->nwrite == pi->nread + PIPESIZE){ //DOC: pipewrite-full
+    if(pi->nwrite == pi->nread + pi->size){ //DOC: pipewrite-full
       wakeup(&pi->nread);
       sleep(&pi->nwrite, &pi->lock);
     } else {
-      char ch;
-      if(copyin(pr->pagetable, &ch, addr + i, 1) == -1)
+      p = pipebuf(pi, pi->nwrite, &m);
+      if(m > pi->nread + pi->size - pi->nwrite)
+        m = pi->nread + pi->size - pi->nwrite;
+      if(m > n - i)
+        m = n - i;
+      if(copyin(pr->pagetable, p, addr + i, m) == -1)
         break;
-      pi->data[pi->nwrite++ % PIPESIZE] = ch;
-      i++;
+      pi->nwrite += m;
+      i += m;
     }
   }
   wakeup(&pi->nread);
@@ -106,9 +162,11 @@ int
 piperead(struct pipe *pi, uint64 addr, int n)
 {
   int i;
+  uint m;
+  char *p;
   struct proc *pr = myproc();
-  char ch;
 
+  lazytouch(addr, n);
   acquire(&pi->lock);
   while(pi->nread == pi->nwrite && pi->writeopen){  //DOC: pipe-empty
     if(pr->killed){
@@ -117,12 +175,15 @@ piperead(struct pipe *pi, uint64 addr, int n)
     }
     sleep(&pi->nread, &pi->lock); //DOC: piperead-sleep
   }
-  for(i = 0; i < n; i++){  //DOC: piperead-copy
-    if(pi->nread == pi->nwrite)
-      break;
-    ch = pi->data[pi->nread++ % PIPESIZE];
-    if(copyout(pr->pagetable, addr + i, &ch, 1) == -1)
+  for(i = 0; i < n && pi->nread != pi->nwrite; i += m){  //DOC: piperead-copy
+    p = pipebuf(pi, pi->nread, &m);
+    if(m > pi->nwrite - pi->nread)
+      m = pi->nwrite - pi->nread;
+    if(m > n - i)
+      m = n - i;
+    if(copyout(pr->pagetable, addr + i, p, m) == -1)
       break;
+    pi->nread += m;
   }
   wakeup(&pi->nwrite);  //DOC: piperead-wakeup
   release(&pi->lock);
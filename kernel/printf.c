@@ -16,17 +16,44 @@
 #include "proc.h"
 
 volatile int panicked = 0;
-
-// lock to avoid interleaving concurrent printf's.
-static struct {
-  struct spinlock lock;
-  int locking;
-} pr;
+static volatile int panicking = 0;
+
+// each hart formats into its own buffer, with interrupts off,
+// and hands the result to the uart in one piece. so harts
+// don't hold each other up while formatting, and only
+// serialize on the copy into the uart's transmit buffer.
+#define PRBUF 128
+static struct prbuf {
+  char buf[PRBUF];
+  int n;
+} pr[NCPU];
 
 static char digits[] = "0123456789abcdef";
 
 static void
-printint(int xx, int base, int sign)
+prflush(struct prbuf *b)
+{
+  int i;
+
+  if(panicking){
+    for(i = 0; i < b->n; i++)
+      uartputc_sync(b->buf[i]);
+  } else {
+    uartputs(b->buf, b->n);
+  }
+  b->n = 0;
+}
+
+static void
+prputc(struct prbuf *b, int c)
+{
+  b->buf[b->n++] = c;
+  if(b->n == PRBUF)
+    prflush(b);
+}
+
+static void
+printint(struct prbuf *b, int xx, int base, int sign)
 {
   char buf[16];
   int i;
@@ -46,17 +73,17 @@ printint(int xx, int base, int sign)
     buf[i++] = '-';
 
   while(--i >= 0)
-    consputc(buf[i]);
+    prputc(b, buf[i]);
 }
 
 static void
-printptr(uint64 x)
+printptr(struct prbuf *b, uint64 x)
 {
   int i;
-  consputc('0');
-  consputc('x');
+  prputc(b, '0');
+  prputc(b, 'x');
   for (i = 0; i < (sizeof(uint64) * 2); i++, x <<= 4)
-    consputc(digits[x >> (sizeof(uint64) * 8 - 4)]);
+    prputc(b, digits[x >> (sizeof(uint64) * 8 - 4)]);
 }
 
 // Print to the console. only understands %d, %x, %p, %s.
@@ -64,20 +91,20 @@ void
 printf(char *fmt, ...)
 {
   va_list ap;
-  int i, c, locking;
+  int i, c;
   char *s;
-
-  locking = pr.locking;
-  if(locking)
-    acquire(&pr.lock);
+  struct prbuf *b;
 
   if (fmt == 0)
     panic("null fmt");
 
+  push_off();
+  b = &pr[cpuid()];
+
   va_start(ap, fmt);
   for(i = 0; (c = fmt[i] & 0xff) != 0; i++){
     if(c != '%'){
-      consputc(c);
+      prputc(b, c);
       continue;
     }
     c = fmt[++i] & 0xff;
@@ -85,39 +112,44 @@ printf(char *fmt, ...)
       break;
     switch(c){
     case 'd':
-      printint(va_arg(ap, int), 10, 1);
+      printint(b, va_arg(ap, int), 10, 1);
       break;
     case 'x':
-      printint(va_arg(ap, int), 16, 1);
+      printint(b, va_arg(ap, int), 16, 1);
       break;
     case 'p':
-      printptr(va_arg(ap, uint64));
+      printptr(b, va_arg(ap, uint64));
       break;
     case 's':
       if((s = va_arg(ap, char*)) == 0)
         s = "(null)";
       for(; *s; s++)
-        consputc(*s);
+        prputc(b, *s);
       break;
     case '%':
-      consputc('%');
+      prputc(b, '%');
       break;
     default:
       // Print unknown % sequence to draw attention.
-      consputc('%');
-      consputc(c);
+      prputc(b, '%');
+      prputc(b, c);
       break;
     }
   }
+  va_end(ap);
 
-  if(locking)
-    release(&pr.lock);
+  if(b->n > 0)
+    prflush(b);
+  pop_off();
 }
 
 void
 panic(char *s)
 {
-  pr.locking = 0;
+  // from here on print synchronously, after whatever
+  // is still waiting in the uart's buffer.
+  panicking = 1;
+  uartdrain();
   printf("panic: ");
   printf(s);
   printf("\n");
@@ -125,10 +157,3 @@ panic(char *s)
   for(;;)
     ;
 }
-
-void
-printfinit(void)
-{
-  initlock(&pr.lock, "pr");
-  pr.locking = 1;
-}
@@ -4,11 +4,13 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "sysstat.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
 
 struct proc proc[NPROC];
+int nprocs;  // procs not UNUSED
 
 struct proc *initproc;
 
@@ -52,6 +54,7 @@ procinit(void)
   initlock(&wait_lock, "wait_lock");
   for(p = proc; p < &proc[NPROC]; p++) {
       initlock(&p->lock, "proc");
+      initlock(&p->glock, "group");
       p->kstack = KSTACK((int) (p - proc));
   }
 }
@@ -100,9 +103,11 @@ allocpid() {
 // Look in the process table for an UNUSED proc.
 // If found, initialize state required to run in the kernel,
 // and return with p->lock held.
+// A thread (for clone()) gets no page table or USYSCALL page
+// of its own; the caller fills in the group's.
 // If there are no free procs, or a memory allocation fails, return 0.
 static struct proc*
-allocproc(void)
+allocproc(int thread)
 {
   struct proc *p;
 
@@ -119,6 +124,9 @@ allocproc(void)
 found:
   p->pid = allocpid();
   p->state = USED;
+  __atomic_fetch_add(&nprocs, 1, __ATOMIC_RELAXED);
+  p->group = p;
+  p->tfva = TRAPFRAME;
 
   // Allocate a trapframe page.
   if((p->trapframe = (struct trapframe *)kalloc()) == 0){
@@ -126,6 +134,15 @@ found:
     release(&p->lock);
     return 0;
   }
+  // and a page for its syscall statistics.
+  if((p->sysstat = (struct sysstat *)kalloc()) == 0){
+    freeproc(p);
+    release(&p->lock);
+    return 0;
+  }
+  memset(p->sysstat, 0, PGSIZE);
+  if(thread)
+    goto context;
 
   //Allocate a usyscall page.
   if((p->uscall = (struct usyscall *)kalloc()) == 0) {
@@ -143,6 +160,7 @@ found:
     return 0;
   }
 
+context:
   // Set up new context to start executing at forkret,
   // which returns to user space.
   memset(&p->context, 0, sizeof(p->context));
@@ -162,18 +180,28 @@ freeproc(struct proc *p)
     kfree((void*)p->trapframe);
   if(p->uscall)
     kfree((void*)p->uscall);
+  if(p->sysstat)
+    kfree((void*)p->sysstat);
   p->trapframe = 0;
-  if(p->pagetable)
+  p->sysstat = 0;
+  // a thread's page table belongs to its group leader.
+  if(p->pagetable && p->group == p)
     proc_freepagetable(p->pagetable, p->sz);
   p->uscall = 0;
   p->pagetable = 0;
   p->sz = 0;
+  p->nseg = 0;
   p->pid = 0;
   p->parent = 0;
+  p->nthread = 0;
+  p->group = 0;
+  p->tfva = 0;
   p->name[0] = 0;
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
+  if(p->state != UNUSED)
+    __atomic_fetch_sub(&nprocs, 1, __ATOMIC_RELAXED);
   p->state = UNUSED;
 }
 
@@ -214,6 +242,15 @@ proc_pagetable(struct proc *p)
     return 0;            
   }
 
+  // and the kernel's shared data page.
+  if(mappages(pagetable, VDATA, PGSIZE, vdatapage(), PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmunmap(pagetable, USYSCALL, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+
   return pagetable;
 }
 
@@ -225,6 +262,7 @@ proc_freepagetable(pagetable_t pagetable, uint64 sz)
   uvmunmap(pagetable, TRAMPOLINE, 1, 0);
   uvmunmap(pagetable, TRAPFRAME, 1, 0);
   uvmunmap(pagetable, USYSCALL, 1, 0);
+  uvmunmap(pagetable, VDATA, 1, 0);
   uvmfree(pagetable, sz);
 }
 
@@ -246,7 +284,7 @@ userinit(void)
 {
   struct proc *p;
 
-  p = allocproc();
+  p = allocproc(0);
   initproc = p;
   
   // allocate one user page and copy init's instructions
@@ -271,18 +309,21 @@ userinit(void)
 int
 growproc(int n)
 {
-  uint sz;
-  struct proc *p = myproc();
+  uint64 sz;
+  struct proc *p = myproc()->group;
 
+  acquire(&p->glock);
   sz = p->sz;
   if(n > 0){
-    if((sz = uvmalloc(p->pagetable, sz, sz + n)) == 0) {
+    if(sz + n > MAXUSER || (sz = uvmalloc(p->pagetable, sz, sz + n)) == 0) {
+      release(&p->glock);
       return -1;
     }
   } else if(n < 0){
     sz = uvmdealloc(p->pagetable, sz, sz + n);
   }
   p->sz = sz;
+  release(&p->glock);
   return 0;
 }
 
@@ -294,19 +335,35 @@ fork(void)
   int i, pid;
   struct proc *np;
   struct proc *p = myproc();
+  struct proc *g = p->group;
 
   // Allocate process.
-  if((np = allocproc()) == 0){
+  if((np = allocproc(0)) == 0){
     return -1;
   }
 
   // Copy user memory from parent to child.
-  if(uvmcopy(p->pagetable, np->pagetable, p->sz) < 0){
+  // A thread forks the whole group's memory, and the
+  // child is an ordinary single-threaded process.
+  // glock keeps a sibling's growproc() from changing it
+  // under the copy.
+  acquire(&g->glock);
+  if(uvmcopy(g->pagetable, np->pagetable, g->sz) < 0){
+    release(&g->glock);
     freeproc(np);
     release(&np->lock);
     return -1;
   }
-  np->sz = p->sz;
+  np->sz = g->sz;
+  release(&g->glock);
+
+  // the child shares the parent's lazily loaded segments.
+  if(g->exe){
+    np->exe = idup(g->exe);
+    iexec(np->exe, 1);
+  }
+  memmove(np->seg, g->seg, sizeof(g->seg));
+  np->nseg = g->nseg;
 
   // copy saved user registers.
   *(np->trapframe) = *(p->trapframe);
@@ -319,9 +376,9 @@ fork(void)
 
   // increment reference counts on open file descriptors.
   for(i = 0; i < NOFILE; i++)
-    if(p->ofile[i])
-      np->ofile[i] = filedup(p->ofile[i]);
-  np->cwd = idup(p->cwd);
+    if(g->ofile[i])
+      np->ofile[i] = filedup(g->ofile[i]);
+  np->cwd = idup(g->cwd);
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
@@ -336,8 +393,173 @@ fork(void)
   acquire(&np->lock);
   np->state = RUNNABLE;
   release(&np->lock);
+  kickidle(1);
+
+  return pid;
+}
+
+// Create a new process running the program at path, building
+// its address space straight from the ELF file rather than
+// copying the caller's as fork() followed by exec() would.
+// The child's fd i is a dup of the caller's fd fdmap[i], or
+// closed if fdmap[i] is -1; fdmap has NOFILE entries.
+// Returns the child's pid, or -1.
+int
+spawn(char *path, char **argv, int *fdmap)
+{
+  int i, argc, pid;
+  struct proc *np;
+  struct proc *p = myproc();
+  struct proc *g = p->group;
+  struct file *of[NOFILE];
+
+  // take the files now, under the group lock: loading the
+  // program sleeps, and a sibling thread could close them.
+  memset(of, 0, sizeof(of));
+  acquire(&g->glock);
+  for(i = 0; i < NOFILE; i++){
+    if(fdmap[i] == -1)
+      continue;
+    if(fdmap[i] < 0 || fdmap[i] >= NOFILE || g->ofile[fdmap[i]] == 0){
+      release(&g->glock);
+      goto bad;
+    }
+    of[i] = filedup(g->ofile[fdmap[i]]);
+  }
+  release(&g->glock);
+
+  // Allocate process.
+  if((np = allocproc(0)) == 0)
+    goto bad;
+
+  // loading the program may sleep, so don't hold np->lock.
+  // np stays USED, so the scheduler leaves it alone.
+  release(&np->lock);
+
+  memset(np->trapframe, 0, sizeof(*np->trapframe));
+  if((argc = execproc(np, path, argv)) < 0){
+    acquire(&np->lock);
+    freeproc(np);
+    release(&np->lock);
+    goto bad;
+  }
+
+  // argc for main(argc, argv); execproc() set a1.
+  np->trapframe->a0 = argc;
+
+  //keep trace.
+  np->mask = p->mask;
+
+  for(i = 0; i < NOFILE; i++)
+    np->ofile[i] = of[i];
+  np->cwd = idup(g->cwd);
+
+  pid = np->pid;
+
+  acquire(&wait_lock);
+  np->parent = p;
+  release(&wait_lock);
+
+  acquire(&np->lock);
+  np->state = RUNNABLE;
+  release(&np->lock);
+  kickidle(1);
 
   return pid;
+
+ bad:
+  for(i = 0; i < NOFILE; i++)
+    if(of[i])
+      fileclose(of[i]);
+  return -1;
+}
+
+// Create a thread in the caller's group that starts at fn(arg)
+// on the given user stack. It shares the group's memory, open
+// files and cwd, and has only its own trapframe, mapped at
+// THREADFRAME(i). Its parent is the group leader, so the leader
+// reaps it with wait(). Returns the new thread's id, or -1.
+int
+clone(uint64 fn, uint64 arg, uint64 stack)
+{
+  int r, tid;
+  struct proc *np;
+  struct proc *p = myproc();
+  struct proc *g = p->group;
+
+  if((stack % 16) != 0 || stack == 0 || stack > g->sz)
+    return -1;
+
+  if((np = allocproc(1)) == 0){
+    return -1;
+  }
+
+  np->group = g;
+  np->tfva = THREADFRAME((int) (np - proc));
+  acquire(&g->glock);
+  r = mappages(g->pagetable, np->tfva, PGSIZE,
+               (uint64)(np->trapframe), PTE_R | PTE_W);
+  release(&g->glock);
+  if(r < 0){
+    freeproc(np);
+    release(&np->lock);
+    return -1;
+  }
+  np->pagetable = g->pagetable;
+
+  *(np->trapframe) = *(p->trapframe);
+  np->trapframe->epc = fn;
+  np->trapframe->a0 = arg;
+  np->trapframe->sp = stack;
+  np->trapframe->ra = 0;  // returning from fn faults; call exit()
+
+  //keep trace.
+  np->mask = p->mask;
+
+  safestrcpy(np->name, p->name, sizeof(p->name));
+
+  tid = np->pid;
+
+  release(&np->lock);
+
+  acquire(&wait_lock);
+  np->parent = g;
+  g->nthread++;
+  release(&wait_lock);
+
+  acquire(&np->lock);
+  np->state = RUNNABLE;
+  release(&np->lock);
+  kickidle(1);
+
+  return tid;
+}
+
+// Kill the other threads of p's group and wait until
+// they have all become zombies, so that nothing runs
+// on the group's memory any more. Their parent (p)
+// or init reaps them.
+static void
+killthreads(struct proc *p)
+{
+  struct proc *t;
+
+  acquire(&wait_lock);
+  while(p->nthread > 0){
+    for(t = proc; t < &proc[NPROC]; t++){
+      if(t == p || t->parent != p)
+        continue;
+      acquire(&t->lock);
+      if(t->group == p && t->state != ZOMBIE){
+        t->killed = 1;
+        if(t->state == SLEEPING)
+          t->state = RUNNABLE;
+      }
+      release(&t->lock);
+    }
+    sleep(p, &wait_lock);
+  }
+  release(&wait_lock);
 }
 
 // Pass p's abandoned children to init.
@@ -366,6 +588,18 @@ exit(int status)
   if(p == initproc)
     panic("init exiting");
 
+  if(p->group != p){
+    // a thread gives back only its trapframe mapping;
+    // everything else belongs to the group leader.
+    acquire(&p->group->glock);
+    uvmunmap(p->pagetable, p->tfva, 1, 0);
+    release(&p->group->glock);
+    goto zombie;
+  }
+
+  // the group goes away with its leader.
+  killthreads(p);
+
   // Close all open files.
   for(int fd = 0; fd < NOFILE; fd++){
     if(p->ofile[fd]){
@@ -375,13 +609,22 @@ exit(int status)
     }
   }
 
+  if(p->exe)
+    iexec(p->exe, -1);
   begin_op();
   iput(p->cwd);
+  if(p->exe)
+    iput(p->exe);
   end_op();
   p->cwd = 0;
+  p->exe = 0;
 
+zombie:
   acquire(&wait_lock);
 
+  if(p->group != p)
+    p->group->nthread--;
+
   // Give any children to init.
   reparent(p);
 
@@ -409,6 +652,10 @@ wait(uint64 addr)
   int havekids, pid;
   struct proc *p = myproc();
 
+  // the status is copied out with locks held.
+  if(addr != 0)
+    lazytouch(addr, sizeof(np->xstate));
+
   acquire(&wait_lock);
 
   for(;;){
@@ -461,12 +708,20 @@ scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  int found;
   
   c->proc = 0;
+  c->start = r_time();
   for(;;){
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
+    // but an idle hart keeps them off from its last scan to
+    // the wfi: a kick taken in between would be lost, and a
+    // pending one still ends the wfi.
+    if(c->idle)
+      intr_off();
 
+    found = 0;
     for(p = proc; p < &proc[NPROC]; p++) {
       acquire(&p->lock);
       if(p->state == RUNNABLE) {
@@ -475,15 +730,61 @@ scheduler(void)
         // before jumping back to us.
         p->state = RUNNING;
         c->proc = p;
+        if(p->group->uscall)
+          p->group->uscall->cpu = cpuid();
+        c->idle = 0;
+        timerslice();
+        c->nswitch++;
+        c->runstart = r_time();
         swtch(&c->context, &p->context);
 
         // Process is done running for now.
         // It should have changed its p->state before coming back.
+        c->busy += r_time() - c->runstart;
+        c->runstart = 0;
         c->proc = 0;
+        found = 1;
       }
       release(&p->lock);
     }
+    if(found)
+      continue;
+
+    if(!c->idle){
+      // say we're idle, stop the tick, and look once more:
+      // a process made RUNNABLE after this point either
+      // shows up in that scan or comes with a kickidle().
+      intr_off();
+      c->idle = 1;
+      __sync_synchronize();
+      timerarm(0);
+      continue;
+    }
+
+    // nothing to do until the next deadline or a kick.
+    wfi();
+  }
+}
+
+// Wake up to n harts that are idle in scheduler(), after
+// making processes RUNNABLE. A kicked hart's timer goes
+// off at once, which ends its wfi.
+void
+kickidle(int n)
+{
+  int i, me;
+
+  __sync_synchronize();
+  push_off();
+  me = cpuid();
+  for(i = 0; i < NCPU && n > 0; i++){
+    if(i != me && cpus[i].idle){
+      cpus[i].idle = 0;
+      *(uint64*)CLINT_MTIMECMP(i) = 0;
+      n--;
+    }
   }
+  pop_off();
 }
 
 // Switch to scheduler.  Must hold only p->lock
@@ -582,16 +883,55 @@ void
 wakeup(void *chan)
 {
   struct proc *p;
+  int n = 0;
 
   for(p = proc; p < &proc[NPROC]; p++) {
     if(p != myproc()){
       acquire(&p->lock);
       if(p->state == SLEEPING && p->chan == chan) {
         p->state = RUNNABLE;
+        n++;
       }
       release(&p->lock);
     }
   }
+  if(n > 0)
+    kickidle(n);
+}
+
+// Wake p if it is sleeping on chan. Like wakeup(), for
+// callers that know which process is waiting, and so
+// needn't scan them all.
+void
+wakeproc(struct proc *p, void *chan)
+{
+  acquire(&p->lock);
+  if(p->state == SLEEPING && p->chan == chan){
+    p->state = RUNNABLE;
+    release(&p->lock);
+    kickidle(1);
+    return;
+  }
+  release(&p->lock);
+}
+
+// Copy the syscall statistics of the process with the
+// given pid to st. Returns 0, or -1 if there is no such process.
+int
+procsysstat(int pid, struct sysstat *st)
+{
+  struct proc *p;
+
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->sysstat){
+      memmove(st, p->sysstat, NSYSCALL * sizeof(*st));
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
 }
 
 // Kill the process with the given pid.
@@ -603,12 +943,20 @@ kill(int pid)
   struct proc *p;
 
   for(p = proc; p < &proc[NPROC]; p++){
+    // peek without the lock, so kill() doesn't take every
+    // p->lock in turn. proc[] entries are never freed, so a
+    // racy read is safe; the match is checked again below.
+    if(p->pid != pid)
+      continue;
     acquire(&p->lock);
     if(p->pid == pid){
       p->killed = 1;
       if(p->state == SLEEPING){
         // Wake process from sleep().
         p->state = RUNNABLE;
+        release(&p->lock);
+        kickidle(1);
+        return 0;
       }
       release(&p->lock);
       return 0;
@@ -677,14 +1025,23 @@ procdump(void)
   }
 }
 
+// number of processes in use.
 uint64
-procnum(void) 
+procnum(void)
 {
-  uint64 res = 0;
-  for(int i = 0; i < NPROC; i++) {
-    if(proc[i].state != UNUSED) {
-      res++;
-    }
-  }
-  return res;
+  return nprocs;
+}
+
+// number of processes waiting for a cpu; a snapshot,
+// without locks.
+uint64
+procrunnable(void)
+{
+  struct proc *p;
+  uint64 n = 0;
+
+  for(p = proc; p < &proc[NPROC]; p++)
+    if(p->state == RUNNABLE)
+      n++;
+  return n;
 }
\ No newline at end of file
@@ -24,6 +24,15 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  int idle;                   // In scheduler() with nothing to run; see kickidle()
+  uint64 timer;               // mtimecmp last set by timerarm()
+  uint64 sliceend;            // when the running process's time slice ends
+  uint64 profnext;            // when to take the next profiling sample
+  uint64 start;               // when scheduler() started, by the time CSR
+  uint64 busy;                // time spent running processes
+  uint64 runstart;            // when the running process got the cpu, or 0
+  uint64 nswitch;             // switches to processes
+  struct mcsnode mcs[NMCS];   // Queue nodes for MCS locks this cpu acquires
 };
 
 extern struct cpu cpus[NCPU];
@@ -80,6 +89,16 @@ struct trapframe {
   /* 280 */ uint64 t6;
 };
 
+// A program segment recorded by exec(). Its pages are not
+// loaded up front; lazyfault() reads each one in from p->exe
+// (or zero-fills it, past filesz) the first time it is touched.
+struct vmseg {
+  uint64 va;                   // Page-aligned start address
+  uint64 memsz;                // Bytes of memory in the segment
+  uint64 filesz;               // Bytes backed by the executable
+  uint64 off;                  // File offset of va
+};
+
 enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
@@ -95,9 +114,18 @@ struct proc {
 
   int mask;                    // a set of sysnumber to be traced
   struct usyscall* uscall;      //pa for USYSCALL
+  struct sysstat *sysstat;     // per-syscall statistics, a page
 
-  // wait_lock must be held when using this:
+  // wait_lock must be held when using these:
   struct proc *parent;         // Parent process
+  int nthread;                 // Live threads in this group, leader excluded
+
+  // A thread made by clone() shares its group leader's page
+  // table, sz, exe/seg, ofile and cwd; code that uses those goes
+  // through p->group, which is p itself for an ordinary process.
+  struct proc *group;          // Thread group leader
+  uint64 tfva;                 // User address of trapframe (TRAPFRAME or a THREADFRAME)
+  struct spinlock glock;       // Leader's: page table changes and ofile slots
 
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Virtual address of kernel stack
@@ -107,5 +135,8 @@ struct proc {
   struct context context;      // swtch() here to run process
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
+  struct inode *exe;           // Executable backing seg[]
+  struct vmseg seg[NSEG];      // Lazily loaded program segments
+  int nseg;                    // Number of valid entries in seg[]
   char name[16];               // Process name (debugging)
 };
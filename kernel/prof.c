@@ -0,0 +1,171 @@
+// Sampling profiler.
+//
+// While profiling is on, timerarm() programs each hart's
+// timer to go off at least every prof.interval, and the trap
+// handlers pass each timer interrupt's pc to profsample().
+// For kernel code it also follows the saved frame pointers
+// (CFLAGS has -fno-omit-frame-pointer) for a backtrace.
+// Samples go in per-hart rings like the syscall trace rings
+// in trace.c: one writer, the hart, with interrupts off; one
+// reader, profread() under prof.lock.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "prof.h"
+#include "defs.h"
+
+#define NPROF 512  // samples per hart
+
+struct pring {
+  struct profsample s[NPROF];
+  uint64 head;  // samples written; advanced by the hart
+  uint64 tail;  // samples read; advanced by profread()
+  uint64 lost;  // samples dropped since the last read
+};
+
+static struct {
+  struct spinlock lock;  // serializes readers
+  uint64 interval;       // time CSR ticks between samples; 0 if off
+  struct pring ring[NCPU];
+} prof;
+
+void
+profinit(void)
+{
+  initlock(&prof.lock, "prof");
+}
+
+// When this hart's timer should next go off for a sample, or
+// ~0 if the profiler is off. timerarm() runs in clockintr(),
+// before the trap handler calls profsample(); a sample due
+// now will be taken on the way out, so arm for the one after
+// it rather than for a time that has already passed.
+uint64
+profdue(uint64 now)
+{
+  struct cpu *c = mycpu();
+
+  if(prof.interval == 0)
+    return ~0L;
+  if(c->profnext <= now)
+    return now + prof.interval;
+  return c->profnext;
+}
+
+// Sample hz times a second, or stop if hz is 0.
+int
+profstart(int hz)
+{
+  int i;
+
+  if(hz < 0 || hz > 10000)
+    return -1;
+  prof.interval = hz ? TIMEFREQ / hz : 0;
+  for(i = 0; i < NCPU; i++)
+    cpus[i].profnext = 0;
+  // let idle harts arm their timers for the first sample.
+  kickidle(NCPU);
+  return 0;
+}
+
+// Follow the frame pointers of kernel code from fp, but only
+// within the stack page that sp is in.
+static int
+backtrace(uint64 *pc, int n, uint64 fp, uint64 sp)
+{
+  uint64 top = PGROUNDDOWN(sp) + PGSIZE;
+  int i;
+
+  for(i = 0; i < n; i++){
+    if(fp % 8 != 0 || fp < sp + 16 || fp > top)
+      break;
+    pc[i] = *(uint64*)(fp - 8);
+    sp = fp;
+    fp = *(uint64*)(fp - 16);
+  }
+  return i;
+}
+
+// Called from usertrap() and kerneltrap() on a timer
+// interrupt, with the interrupted pc, and, for kernel code,
+// its frame pointer and stack pointer.
+void
+profsample(int user, uint64 pc, uint64 fp, uint64 sp)
+{
+  struct cpu *c = mycpu();
+  struct proc *p = myproc();
+  struct pring *rg;
+  struct profsample *s;
+  uint64 h, now;
+
+  if(prof.interval == 0 || (now = r_time()) < c->profnext)
+    return;
+  c->profnext = now + prof.interval;
+
+  rg = &prof.ring[cpuid()];
+  h = rg->head;
+  if(h - __atomic_load_n(&rg->tail, __ATOMIC_ACQUIRE) == NPROF){
+    __atomic_fetch_add(&rg->lost, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  s = &rg->s[h % NPROF];
+  s->pc[0] = pc;
+  s->depth = 1;
+  if(!user)
+    s->depth += backtrace(s->pc + 1, PROFDEPTH - 1, fp, sp);
+  s->user = user;
+  s->pid = p ? p->pid : 0;
+  s->cpu = cpuid();
+  __atomic_store_n(&rg->head, h + 1, __ATOMIC_RELEASE);
+}
+
+// Copy up to n samples to user address dst, taking them out
+// of the rings. A hart that dropped samples first yields one
+// with depth 0 and the count in pc[0]. Returns the number of
+// samples copied.
+int
+profread(uint64 dst, int n)
+{
+  struct pring *rg;
+  struct profsample lost;
+  uint64 h, t;
+  int i, got;
+
+  if(n <= 0)
+    return 0;
+  // copying out under prof.lock mustn't have to page
+  // anything in from disk.
+  lazytouch(dst, (uint64)n * sizeof(struct profsample));
+  acquire(&prof.lock);
+
+  got = 0;
+  for(i = 0; i < NCPU && got < n; i++){
+    rg = &prof.ring[i];
+    if(__atomic_load_n(&rg->lost, __ATOMIC_RELAXED) != 0){
+      memset(&lost, 0, sizeof(lost));
+      lost.cpu = i;
+      lost.pc[0] = __atomic_exchange_n(&rg->lost, 0, __ATOMIC_RELAXED);
+      if(either_copyout(1, dst, &lost, sizeof(lost)) == -1)
+        break;
+      dst += sizeof(lost);
+      got++;
+    }
+    h = __atomic_load_n(&rg->head, __ATOMIC_ACQUIRE);
+    for(t = rg->tail; t != h && got < n; t++){
+      if(either_copyout(1, dst, &rg->s[t % NPROF], sizeof(struct profsample)) == -1)
+        break;
+      dst += sizeof(struct profsample);
+      got++;
+    }
+    __atomic_store_n(&rg->tail, t, __ATOMIC_RELEASE);
+    if(t != h && got < n)
+      break;  // copyout failed
+  }
+
+  release(&prof.lock);
+  return got;
+}
@@ -0,0 +1,11 @@
+// One profiling sample, taken by a timer interrupt
+// and returned by profread().
+#define PROFDEPTH 8
+
+struct profsample {
+  uint64 pc[PROFDEPTH];  // interrupted pc, then return addresses
+  int pid;               // 0 if the hart was idle
+  char depth;            // entries used in pc[]
+  char user;             // interrupted user code? then depth is 1
+  short cpu;
+};
@@ -0,0 +1,77 @@
+// Reader-writer spin locks, for read-mostly tables whose
+// lookups shouldn't serialize against each other.
+//
+// A waiting writer keeps new readers out, so that a stream
+// of readers can't starve it. Like spinlocks, these keep
+// interrupts off while held, and may not be held across
+// sleep().
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "rwlock.h"
+#include "riscv.h"
+#include "proc.h"
+#include "defs.h"
+
+void
+initrwlock(struct rwlock *lk, char *name)
+{
+  lk->name = name;
+  lk->readers = 0;
+  lk->writer = 0;
+  lk->cpu = 0;
+}
+
+void
+acquireread(struct rwlock *lk)
+{
+  push_off(); // disable interrupts to avoid deadlock.
+  if(lk->cpu == mycpu())
+    panic("acquireread");
+
+  for(;;){
+    while(__atomic_load_n(&lk->writer, __ATOMIC_RELAXED))
+      ;
+    __atomic_fetch_add(&lk->readers, 1, __ATOMIC_SEQ_CST);
+    // a writer that arrived in between wins; back off.
+    if(__atomic_load_n(&lk->writer, __ATOMIC_SEQ_CST) == 0)
+      break;
+    __atomic_fetch_sub(&lk->readers, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+void
+releaseread(struct rwlock *lk)
+{
+  __atomic_fetch_sub(&lk->readers, 1, __ATOMIC_RELEASE);
+  pop_off();
+}
+
+void
+acquirewrite(struct rwlock *lk)
+{
+  push_off(); // disable interrupts to avoid deadlock.
+  if(lk->cpu == mycpu())
+    panic("acquirewrite");
+
+  while(__sync_lock_test_and_set(&lk->writer, 1) != 0)
+    ;
+  // wait for the readers already inside to leave.
+  while(__atomic_load_n(&lk->readers, __ATOMIC_SEQ_CST) != 0)
+    ;
+  __sync_synchronize();
+  lk->cpu = mycpu();
+}
+
+void
+releasewrite(struct rwlock *lk)
+{
+  if(lk->cpu != mycpu())
+    panic("releasewrite");
+  lk->cpu = 0;
+  __sync_synchronize();
+  __sync_lock_release(&lk->writer);
+  pop_off();
+}
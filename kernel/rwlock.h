@@ -0,0 +1,9 @@
+// Reader-writer spin lock: any number of readers, or one writer.
+struct rwlock {
+  uint readers;      // Number of readers holding the lock
+  uint writer;       // Is a writer holding or waiting for the lock?
+
+  // For debugging:
+  char *name;        // Name of lock.
+  struct cpu *cpu;   // The cpu holding the write lock.
+};
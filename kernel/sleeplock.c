@@ -1,4 +1,11 @@
 // Sleeping locks
+//
+// Adaptive: an acquirer first spins for a while if the holder
+// is running on another hart, since buffer and inode locks
+// are usually held only briefly. Otherwise it queues up and
+// sleeps, and releasesleep() hands the lock straight to the
+// first waiter and wakes just that process. With no waiters,
+// release costs no wakeup at all.
 
 #include "types.h"
 #include "riscv.h"
@@ -9,34 +16,79 @@
 #include "proc.h"
 #include "sleeplock.h"
 
+#define SLEEPSPIN 20000  // max spin iterations before sleeping
+
 void
 initsleeplock(struct sleeplock *lk, char *name)
 {
   initlock(&lk->lk, "sleep lock");
   lk->name = name;
   lk->locked = 0;
+  lk->owner = 0;
+  lk->waiters = 0;
   lk->pid = 0;
 }
 
+// is the holder running, so likely to release soon?
+// a racy read, but only a hint.
+static int
+ownerrunning(struct sleeplock *lk)
+{
+  struct proc *o = __atomic_load_n(&lk->owner, __ATOMIC_RELAXED);
+
+  return o != 0 && __atomic_load_n(&o->state, __ATOMIC_RELAXED) == RUNNING;
+}
+
 void
 acquiresleep(struct sleeplock *lk)
 {
+  struct proc *p = myproc();
+  struct sleepwaiter w, **pp;
+  int spins = 0;
+
   acquire(&lk->lk);
-  while (lk->locked) {
-    sleep(lk, &lk->lk);
+  // spin only if no one is queued, so as not to jump the line.
+  while(lk->locked && lk->waiters == 0 && spins < SLEEPSPIN && ownerrunning(lk)){
+    release(&lk->lk);
+    while(__atomic_load_n(&lk->locked, __ATOMIC_RELAXED) &&
+          spins++ < SLEEPSPIN && ownerrunning(lk))
+      ;
+    acquire(&lk->lk);
+  }
+
+  if(lk->locked){
+    w.p = p;
+    w.next = 0;
+    for(pp = &lk->waiters; *pp; pp = &(*pp)->next)
+      ;
+    *pp = &w;
+    // releasesleep() makes us the owner before waking us.
+    while(lk->owner != p)
+      sleep(&w, &lk->lk);
+  } else {
+    lk->locked = 1;
+    lk->owner = p;
   }
-  lk->locked = 1;
-  lk->pid = myproc()->pid;
+  lk->pid = p->pid;
   release(&lk->lk);
 }
 
 void
 releasesleep(struct sleeplock *lk)
 {
+  struct sleepwaiter *w;
+
   acquire(&lk->lk);
-  lk->locked = 0;
   lk->pid = 0;
-  wakeup(lk);
+  if((w = lk->waiters) != 0){
+    // hand over: the lock stays locked, for w->p.
+    lk->waiters = w->next;
+    lk->owner = w->p;
+    wakeproc(w->p, w);
+  } else {
+    lk->locked = 0;
+    lk->owner = 0;
+  }
   release(&lk->lk);
 }
 
@@ -46,10 +98,7 @@ holdingsleep(struct sleeplock *lk)
   int r;
   
   acquire(&lk->lk);
-  r = lk->locked && (lk->pid == myproc()->pid);
+  r = lk->locked && (lk->owner == myproc());
   release(&lk->lk);
   return r;
 }
-
-
-
@@ -1,10 +1,17 @@
+// A process waiting in acquiresleep(); lives on its stack.
+struct sleepwaiter {
+  struct proc *p;
+  struct sleepwaiter *next;
+};
+
 // Long-term locks for processes
 struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
+  struct proc *owner;          // Process holding lock
+  struct sleepwaiter *waiters; // FIFO of sleeping acquirers
   
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
 };
-
@@ -8,12 +8,119 @@
 #include "proc.h"
 #include "defs.h"
 
+// Every lock is registered in locks[], so that statslock()
+// can report on it. Locks that come and go, like a pipe's,
+// must be freelock()ed before their memory is reused.
+#define NLOCK 500
+
+static struct spinlock *locks[NLOCK];
+static struct spinlock lock_locks;  // zeroed is unlocked, so usable before initlock()
+
+static void
+findslot(struct spinlock *lk)
+{
+  int i;
+
+  acquire(&lock_locks);
+  for(i = 0; i < NLOCK; i++){
+    if(locks[i] == 0){
+      locks[i] = lk;
+      release(&lock_locks);
+      return;
+    }
+  }
+  panic("findslot");
+}
+
+void
+freelock(struct spinlock *lk)
+{
+  int i;
+
+  acquire(&lock_locks);
+  for(i = 0; i < NLOCK; i++){
+    if(locks[i] == lk){
+      locks[i] = 0;
+      break;
+    }
+  }
+  release(&lock_locks);
+}
+
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
   lk->locked = 0;
   lk->cpu = 0;
+  lk->mcs = 0;
+  lk->tail = 0;
+  lk->qnode = 0;
+  lk->nacquire = 0;
+  lk->ncontend = 0;
+  lk->nspin = 0;
+  lk->maxhold = 0;
+  if(lk != &lock_locks)
+    findslot(lk);
+}
+
+// Like initlock(), but waiters queue up (MCS), so a heavily
+// contended lock is handed over fairly and without every
+// cpu hammering the same cache line.
+void
+initmcslock(struct spinlock *lk, char *name)
+{
+  initlock(lk, name);
+  lk->mcs = 1;
+}
+
+// Wait in line for an MCS lock. Returns the spin count.
+static uint64
+mcsacquire(struct spinlock *lk)
+{
+  struct cpu *c = mycpu();
+  struct mcsnode *n, *prev;
+  uint64 spins = 0;
+
+  for(n = c->mcs; n < &c->mcs[NMCS]; n++)
+    if(!n->inuse)
+      break;
+  if(n == &c->mcs[NMCS])
+    panic("mcsacquire: too many");
+  n->inuse = 1;
+  n->next = 0;
+  n->locked = 1;
+
+  prev = __atomic_exchange_n(&lk->tail, n, __ATOMIC_ACQ_REL);
+  if(prev){
+    __atomic_store_n(&prev->next, n, __ATOMIC_RELEASE);
+    while(__atomic_load_n(&n->locked, __ATOMIC_ACQUIRE))
+      spins++;
+  }
+  lk->qnode = n;
+  lk->locked = 1;
+  return spins;
+}
+
+// Hand an MCS lock to the next cpu in line, if any.
+static void
+mcsrelease(struct spinlock *lk)
+{
+  struct mcsnode *n = lk->qnode, *next;
+
+  lk->qnode = 0;
+  lk->locked = 0;
+  if((next = __atomic_load_n(&n->next, __ATOMIC_ACQUIRE)) == 0){
+    if(__sync_bool_compare_and_swap(&lk->tail, n, 0)){
+      n->inuse = 0;
+      return;
+    }
+    // a waiter is between its exchange and linking in.
+    while((next = __atomic_load_n(&n->next, __ATOMIC_ACQUIRE)) == 0)
+      ;
+  }
+  __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+  n->inuse = 0;
 }
 
 // Acquire the lock.
@@ -21,16 +128,22 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint64 spins = 0;
+
   push_off(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
-  //   a5 = 1
-  //   s1 = &lk->locked
-  //   amoswap.w.aq a5, a5, (s1)
-  while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
-    ;
+  if(lk->mcs){
+    spins = mcsacquire(lk);
+  } else {
+    // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
+    //   a5 = 1
+    //   s1 = &lk->locked
+    //   amoswap.w.aq a5, a5, (s1)
+    while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
+      spins++;
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,17 +153,37 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+
+  lk->nacquire++;
+  if(spins){
+    lk->ncontend++;
+    lk->nspin += spins;
+  }
+  lk->tacquire = r_cycle();
 }
 
 // Release the lock.
 void
 release(struct spinlock *lk)
 {
+  uint64 held;
+
   if(!holding(lk))
     panic("release");
 
+  held = r_cycle() - lk->tacquire;
+  if(held > lk->maxhold)
+    lk->maxhold = held;
+
   lk->cpu = 0;
 
+  if(lk->mcs){
+    __sync_synchronize();
+    mcsrelease(lk);
+    pop_off();
+    return;
+  }
+
   // Tell the C compiler and the CPU to not move loads or stores
   // past this point, to ensure that all the stores in the critical
   // section are visible to other CPUs before the lock is released,
@@ -108,3 +241,51 @@ pop_off(void)
   if(c->noff == 0 && c->intena)
     intr_on();
 }
+
+// Print lock statistics into buf, summed over all the locks
+// that share a name (every "proc" lock, say), for the
+// statistics device. Returns the number of bytes written.
+// The caller serializes calls (sum[] is too big for the stack).
+int
+statslock(char *buf, int sz)
+{
+  static struct {
+    char *name;
+    int n, mcs;
+    uint64 nacquire, ncontend, nspin, maxhold;
+  } sum[64];
+  int i, j, nsum = 0, n;
+  struct spinlock *lk;
+
+  acquire(&lock_locks);
+  for(i = 0; i < NLOCK; i++){
+    if((lk = locks[i]) == 0)
+      continue;
+    for(j = 0; j < nsum; j++)
+      if(strncmp(sum[j].name, lk->name, 32) == 0)
+        break;
+    if(j == nsum){
+      if(nsum == NELEM(sum))
+        continue;
+      memset(&sum[j], 0, sizeof(sum[j]));
+      sum[j].name = lk->name;
+      nsum++;
+    }
+    sum[j].n++;
+    sum[j].mcs |= lk->mcs;
+    sum[j].nacquire += lk->nacquire;
+    sum[j].ncontend += lk->ncontend;
+    sum[j].nspin += lk->nspin;
+    if(lk->maxhold > sum[j].maxhold)
+      sum[j].maxhold = lk->maxhold;
+  }
+  release(&lock_locks);
+
+  n = snprintf(buf, sz, "lock (count): acquire contended spins maxhold(cycles)\n");
+  for(j = 0; j < nsum && n < sz; j++){
+    n += snprintf(buf+n, sz-n, "%s%s (%d): %l %l %l %l\n", sum[j].name,
+                  sum[j].mcs ? " [mcs]" : "", sum[j].n, sum[j].nacquire,
+                  sum[j].ncontend, sum[j].nspin, sum[j].maxhold);
+  }
+  return n;
+}
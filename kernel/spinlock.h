@@ -1,9 +1,31 @@
+// A queue node for an MCS lock; each cpu has NMCS of them.
+struct mcsnode {
+  struct mcsnode *next;   // Next waiter in the queue
+  int locked;             // Spin here until the previous holder clears it
+  int inuse;
+};
+
+#define NMCS 4            // MCS locks one cpu can hold at once
+
 // Mutual exclusion lock.
 struct spinlock {
   uint locked;       // Is the lock held?
 
+  // initmcslock() locks queue their waiters instead of
+  // all spinning on locked: each cpu spins on its own
+  // mcsnode, and the holder hands over in FIFO order.
+  int mcs;                  // Is this an MCS lock?
+  struct mcsnode *tail;     // Last waiter in the queue, or 0
+  struct mcsnode *qnode;    // The holder's node
+
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
-};
 
+  // Statistics, updated while the lock is held:
+  uint64 nacquire;   // Times acquired
+  uint64 ncontend;   // Acquisitions that had to wait
+  uint64 nspin;      // Total spin loop iterations
+  uint64 maxhold;    // Longest hold, in cycles
+  uint64 tacquire;   // Cycle counter at the last acquire
+};
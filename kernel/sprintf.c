@@ -0,0 +1,108 @@
+//
+// formatted output to a buffer -- snprintf, for the statistics device.
+//
+
+#include <stdarg.h>
+
+#include "types.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "riscv.h"
+#include "defs.h"
+
+static char digits[] = "0123456789abcdef";
+
+static int
+sputc(char *s, int sz, int n, char c)
+{
+  if(n < sz)
+    s[n] = c;
+  return n + 1;
+}
+
+static int
+sprintint(char *s, int sz, int n, uint64 x, int base, int neg)
+{
+  char buf[24];
+  int i;
+
+  i = 0;
+  do {
+    buf[i++] = digits[x % base];
+  } while((x /= base) != 0);
+
+  if(neg)
+    buf[i++] = '-';
+
+  while(--i >= 0)
+    n = sputc(s, sz, n, buf[i]);
+  return n;
+}
+
+// Print to buf, which holds sz bytes. Understands %d, %l
+// (uint64 in decimal), %x, %p, %s. Output is truncated to
+// fit, and NUL-terminated if there is room.
+// Returns the number of bytes written, not counting the NUL.
+int
+snprintf(char *buf, int sz, char *fmt, ...)
+{
+  va_list ap;
+  int i, c, d, n;
+  char *s;
+
+  if(fmt == 0)
+    panic("null fmt");
+
+  n = 0;
+  va_start(ap, fmt);
+  for(i = 0; (c = fmt[i] & 0xff) != 0; i++){
+    if(c != '%'){
+      n = sputc(buf, sz, n, c);
+      continue;
+    }
+    c = fmt[++i] & 0xff;
+    if(c == 0)
+      break;
+    switch(c){
+    case 'd':
+      d = va_arg(ap, int);
+      n = sprintint(buf, sz, n, d < 0 ? -(uint64)d : d, 10, d < 0);
+      break;
+    case 'l':
+      n = sprintint(buf, sz, n, va_arg(ap, uint64), 10, 0);
+      break;
+    case 'x':
+      n = sprintint(buf, sz, n, va_arg(ap, uint), 16, 0);
+      break;
+    case 'p':
+      n = sputc(buf, sz, n, '0');
+      n = sputc(buf, sz, n, 'x');
+      n = sprintint(buf, sz, n, va_arg(ap, uint64), 16, 0);
+      break;
+    case 's':
+      if((s = va_arg(ap, char*)) == 0)
+        s = "(null)";
+      for(; *s; s++)
+        n = sputc(buf, sz, n, *s);
+      break;
+    case '%':
+      n = sputc(buf, sz, n, '%');
+      break;
+    default:
+      // Print unknown % sequence to draw attention.
+      n = sputc(buf, sz, n, '%');
+      n = sputc(buf, sz, n, c);
+      break;
+    }
+  }
+  va_end(ap);
+
+  if(n > sz)
+    n = sz;
+  if(n < sz)
+    buf[n] = 0;
+  return n;
+}
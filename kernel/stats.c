@@ -0,0 +1,70 @@
+//
+// The statistics device: reading it returns a report on the
+// kernel's spinlocks, generated afresh by each open-and-read.
+//
+
+#include "types.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "riscv.h"
+#include "defs.h"
+
+#define BUFSZ 4096
+
+static struct {
+  struct spinlock lock;
+  char buf[BUFSZ];
+  int sz;
+  int off;
+} stats;
+
+int
+statswrite(int user_src, uint64 src, int n)
+{
+  return -1;
+}
+
+// Hand out the report a piece at a time; once it has all
+// been read, return 0 (end of file) and start over.
+int
+statsread(int user_dst, uint64 dst, int n)
+{
+  int m;
+
+  // copying out under stats.lock mustn't have to page
+  // anything in from disk.
+  if(user_dst)
+    lazytouch(dst, n);
+  acquire(&stats.lock);
+
+  if(stats.sz == 0)
+    stats.sz = statslock(stats.buf, BUFSZ);
+  m = stats.sz - stats.off;
+
+  if(m > 0){
+    if(m > n)
+      m = n;
+    if(either_copyout(user_dst, dst, stats.buf+stats.off, m) == -1)
+      m = -1;
+    else
+      stats.off += m;
+  } else {
+    m = 0;
+    stats.sz = 0;
+    stats.off = 0;
+  }
+  release(&stats.lock);
+  return m;
+}
+
+void
+statsinit(void)
+{
+  initlock(&stats.lock, "stats");
+
+  devsw[STATS].read = statsread;
+  devsw[STATS].write = statswrite;
+}
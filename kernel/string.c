@@ -1,13 +1,69 @@
 #include "types.h"
+#include "riscv.h"
+
+// The mem* routines move a uint64 at a time, eight words per
+// loop iteration, whenever the two pointers share an alignment,
+// and fall back to bytes for the ragged ends. Whole aligned
+// pages, as in kalloc(), uvmalloc() and uvmcopy(), take the
+// page routines, which need no end handling at all.
+
+#define WSIZE sizeof(uint64)
+#define WMASK (WSIZE - 1)
+
+static void
+pagezero(uint64 *d, uint64 w)
+{
+  uint64 *e = d + PGSIZE/WSIZE;
+
+  for(; d < e; d += 8){
+    d[0] = w; d[1] = w; d[2] = w; d[3] = w;
+    d[4] = w; d[5] = w; d[6] = w; d[7] = w;
+  }
+}
+
+static void
+pagecopy(uint64 *d, const uint64 *s)
+{
+  uint64 *e = d + PGSIZE/WSIZE;
+
+  for(; d < e; d += 8, s += 8){
+    uint64 a0 = s[0], a1 = s[1], a2 = s[2], a3 = s[3];
+    uint64 a4 = s[4], a5 = s[5], a6 = s[6], a7 = s[7];
+    d[0] = a0; d[1] = a1; d[2] = a2; d[3] = a3;
+    d[4] = a4; d[5] = a5; d[6] = a6; d[7] = a7;
+  }
+}
 
 void*
 memset(void *dst, int c, uint n)
 {
   char *cdst = (char *) dst;
-  int i;
-  for(i = 0; i < n; i++){
-    cdst[i] = c;
+  uint64 w, *wdst;
+
+  w = (uchar)c;
+  w |= w << 8;
+  w |= w << 16;
+  w |= w << 32;
+
+  if(n == PGSIZE && ((uint64)cdst % PGSIZE) == 0){
+    pagezero((uint64*)cdst, w);
+    return dst;
+  }
+
+  while(n > 0 && ((uint64)cdst & WMASK)){
+    *cdst++ = c;
+    n--;
+  }
+  wdst = (uint64*)cdst;
+  for(; n >= 8*WSIZE; n -= 8*WSIZE, wdst += 8){
+    wdst[0] = w; wdst[1] = w; wdst[2] = w; wdst[3] = w;
+    wdst[4] = w; wdst[5] = w; wdst[6] = w; wdst[7] = w;
   }
+  for(; n >= WSIZE; n -= WSIZE)
+    *wdst++ = w;
+  cdst = (char*)wdst;
+  while(n-- > 0)
+    *cdst++ = c;
   return dst;
 }
 
@@ -18,6 +74,17 @@ memcmp(const void *v1, const void *v2, uint n)
 
   s1 = v1;
   s2 = v2;
+  if((((uint64)s1 ^ (uint64)s2) & WMASK) == 0){
+    while(n > 0 && ((uint64)s1 & WMASK)){
+      if(*s1 != *s2)
+        return *s1 - *s2;
+      s1++, s2++, n--;
+    }
+    // skip equal words; the bytes below find the difference.
+    while(n >= WSIZE && *(uint64*)s1 == *(uint64*)s2){
+      s1 += WSIZE, s2 += WSIZE, n -= WSIZE;
+    }
+  }
   while(n-- > 0){
     if(*s1 != *s2)
       return *s1 - *s2;
@@ -32,20 +99,60 @@ memmove(void *dst, const void *src, uint n)
 {
   const char *s;
   char *d;
+  const uint64 *ws;
+  uint64 *wd;
+  int words;
 
   if(n == 0)
     return dst;
   
   s = src;
   d = dst;
+  // copy words only if s and d can both be aligned.
+  words = (((uint64)s ^ (uint64)d) & WMASK) == 0;
   if(s < d && s + n > d){
     s += n;
     d += n;
+    if(words){
+      while(n > 0 && ((uint64)d & WMASK)){
+        *--d = *--s;
+        n--;
+      }
+      ws = (const uint64*)s;
+      wd = (uint64*)d;
+      for(; n >= WSIZE; n -= WSIZE)
+        *--wd = *--ws;
+      s = (const char*)ws;
+      d = (char*)wd;
+    }
     while(n-- > 0)
       *--d = *--s;
-  } else
+  } else {
+    if(n == PGSIZE && ((uint64)s % PGSIZE) == 0 && ((uint64)d % PGSIZE) == 0){
+      pagecopy((uint64*)d, (const uint64*)s);
+      return dst;
+    }
+    if(words){
+      while(n > 0 && ((uint64)d & WMASK)){
+        *d++ = *s++;
+        n--;
+      }
+      ws = (const uint64*)s;
+      wd = (uint64*)d;
+      for(; n >= 8*WSIZE; n -= 8*WSIZE, wd += 8, ws += 8){
+        uint64 a0 = ws[0], a1 = ws[1], a2 = ws[2], a3 = ws[3];
+        uint64 a4 = ws[4], a5 = ws[5], a6 = ws[6], a7 = ws[7];
+        wd[0] = a0; wd[1] = a1; wd[2] = a2; wd[3] = a3;
+        wd[4] = a4; wd[5] = a5; wd[6] = a6; wd[7] = a7;
+      }
+      for(; n >= WSIZE; n -= WSIZE)
+        *wd++ = *ws++;
+      s = (const char*)ws;
+      d = (char*)wd;
+    }
     while(n-- > 0)
       *d++ = *s++;
+  }
 
   return dst;
 }
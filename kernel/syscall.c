@@ -5,13 +5,16 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "syscall.h"
+#include "sysname.h"
+#include "trace.h"
+#include "sysstat.h"
 #include "defs.h"
 
 // Fetch the uint64 at addr from the current process.
 int
 fetchaddr(uint64 addr, uint64 *ip)
 {
-  struct proc *p = myproc();
+  struct proc *p = myproc()->group;
   if(addr >= p->sz || addr+sizeof(uint64) > p->sz)
     return -1;
   if(copyin(p->pagetable, (char *)ip, addr, sizeof(*ip)) != 0)
@@ -106,32 +109,21 @@ extern uint64 sys_write(void);
 extern uint64 sys_uptime(void);
 extern uint64 sys_trace(void);
 extern uint64 sys_sysinfo(void);
+extern uint64 sys_spawn(void);
+extern uint64 sys_clone(void);
+extern uint64 sys_futex_wait(void);
+extern uint64 sys_futex_wake(void);
+extern uint64 sys_nanosleep(void);
+extern uint64 sys_clock_gettime(void);
+extern uint64 sys_traceread(void);
+extern uint64 sys_sysstat(void);
+extern uint64 sys_prof(void);
+extern uint64 sys_profread(void);
+extern uint64 sys_getdents(void);
+extern uint64 sys_readdirplus(void);
+extern uint64 sys_pipe2(void);
+extern uint64 sys_sysinfo2(void);
 
-static char* syscall_name[] = {
-[SYS_fork] = "fork",
-[SYS_exit] = "exit",
-[SYS_wait] = "wait",
-[SYS_pipe] = "pipe",
-[SYS_read] = "read",
-[SYS_kill] = "kill",
-[SYS_exec] = "exec",
-[SYS_fstat] = "fstat",
-[SYS_chdir] = "chdir",
-[SYS_dup]   = "dup",
-[SYS_getpid] = "getpid",
-[SYS_sbrk]   = "sbrk",
-[SYS_sleep]  = "sleep",
-[SYS_uptime] = "uptime",
-[SYS_open]   = "open",
-[SYS_write]  = "write",
-[SYS_mknod]  = "mknod",
-[SYS_unlink] = "unlink",
-[SYS_link]   = "link",
-[SYS_mkdir]  = "mkdir",
-[SYS_close]  = "close",
-[SYS_trace]  = "trace",
-[SYS_sysinfo] = "sysinfo",
-};
 #ifdef LAB_NET
 extern uint64 sys_connect(void);
 #endif
@@ -163,6 +155,20 @@ static uint64 (*syscalls[])(void) = {
 [SYS_close]   sys_close,
 [SYS_trace]   sys_trace,
 [SYS_sysinfo] sys_sysinfo,
+[SYS_spawn]   sys_spawn,
+[SYS_clone]   sys_clone,
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+[SYS_nanosleep] sys_nanosleep,
+[SYS_clock_gettime] sys_clock_gettime,
+[SYS_traceread] sys_traceread,
+[SYS_sysstat] sys_sysstat,
+[SYS_prof]    sys_prof,
+[SYS_profread] sys_profread,
+[SYS_getdents] sys_getdents,
+[SYS_readdirplus] sys_readdirplus,
+[SYS_pipe2]   sys_pipe2,
+[SYS_sysinfo2] sys_sysinfo2,
 #ifdef LAB_NET
 [SYS_connect] sys_connect,
 #endif
@@ -172,20 +178,124 @@ static uint64 (*syscalls[])(void) = {
 };
 
 
+// per-hart syscall statistics; a hart updates its own
+// with interrupts off.
+static struct sysstat cpustat[NCPU][NSYSCALL];
+
+// cycles per tick of the time CSR, measured at boot, for
+// timing calls that moved to another hart while they slept.
+static uint64 cyclespertime;
+
+void
+syscallinit(void)
+{
+  uint64 t0, c0;
+
+  if(NELEM(syscalls) > NSYSCALL || NSYSCALL * sizeof(struct sysstat) > PGSIZE)
+    panic("syscallinit: NSYSCALL");
+
+  t0 = r_time();
+  c0 = r_cycle();
+  while(r_time() - t0 < TIMEFREQ / 1000)
+    ;
+  cyclespertime = (r_cycle() - c0) / (r_time() - t0);
+}
+
+static void
+account(struct sysstat *s, uint64 d, int b)
+{
+  s->count++;
+  s->cycles += d;
+  s->hist[b]++;
+}
+
+// charge call num, begun on hart cpu at time t0 and cycle
+// c0, to this hart and to p.
+static void
+sysaccount(struct proc *p, int num, int cpu, uint64 t0, uint64 c0)
+{
+  uint64 d;
+  int b;
+
+  push_off();
+  if(cpuid() == cpu)
+    d = r_cycle() - c0;
+  else
+    d = (r_time() - t0) * cyclespertime;
+  for(b = 0; b < NHIST-1 && (d >> (b + HISTSHIFT)) != 0; b++)
+    ;
+  account(&cpustat[cpuid()][num], d, b);
+  account(&p->sysstat[num], d, b);
+  pop_off();
+}
+
+// Copy the statistics selected by which and id (see
+// sysstat.h) to user address dst.
+int
+sysstatread(int which, int id, uint64 dst)
+{
+  struct sysstat *st, *s;
+  int i, j, k, r;
+
+  if((st = (struct sysstat *)kalloc()) == 0)
+    return -1;
+  memset(st, 0, PGSIZE);
+  r = -1;
+  switch(which){
+  case SS_ALL:
+  case SS_CPU:
+    if(which == SS_CPU && (id < 0 || id >= NCPU))
+      break;
+    for(i = 0; i < NCPU; i++){
+      if(which == SS_CPU && i != id)
+        continue;
+      for(j = 0; j < NSYSCALL; j++){
+        s = &cpustat[i][j];
+        st[j].count += s->count;
+        st[j].cycles += s->cycles;
+        for(k = 0; k < NHIST; k++)
+          st[j].hist[k] += s->hist[k];
+      }
+    }
+    r = 0;
+    break;
+  case SS_PROC:
+    r = procsysstat(id, st);
+    break;
+  }
+  if(r == 0 && either_copyout(1, dst, st, NSYSCALL * sizeof(*st)) == -1)
+    r = -1;
+  kfree(st);
+  return r;
+}
 
 void
 syscall(void)
 {
-  int num, mask, pid;
+  int num, cpu;
   struct proc *p = myproc();
+  struct tracerec r;
 
   num = p->trapframe->a7;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
+    // note the arguments now; the call may change the mask
+    // (trace()) or the trapframe (exec()).
+    r.arg[0] = p->trapframe->a0;
+    r.arg[1] = p->trapframe->a1;
+    r.arg[2] = p->trapframe->a2;
+    r.arg[3] = p->trapframe->a3;
+    push_off();
+    cpu = cpuid();
+    r.time = r_time();
+    r.cycle = r_cycle();
+    pop_off();
     p->trapframe->a0 = syscalls[num]();
-    mask = p->mask;
-    pid = p->pid;
-    if(mask >> num & 1) {
-      printf("%d: syscall %s -> %d\n", pid, syscall_name[num], p->trapframe->a0);
+    sysaccount(p, num, cpu, r.time, r.cycle);
+    if(num < 32 && (p->mask >> num & 1)) {
+      r.ret = p->trapframe->a0;
+      r.pid = p->pid;
+      r.num = num;
+      tracerecord(&r);
     }
   } else {
     printf("%d %s: unknown sys call %d\n",
@@ -31,3 +31,17 @@
 #define SYS_munmap    28
 #define SYS_connect   29
 #define SYS_pgaccess  30
+#define SYS_spawn     31
+#define SYS_clone     32
+#define SYS_futex_wait 33
+#define SYS_futex_wake 34
+#define SYS_nanosleep 35
+#define SYS_clock_gettime 36
+#define SYS_traceread 37
+#define SYS_sysstat 38
+#define SYS_prof    39
+#define SYS_profread 40
+#define SYS_getdents 41
+#define SYS_readdirplus 42
+#define SYS_pipe2   43
+#define SYS_sysinfo2 44
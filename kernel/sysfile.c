@@ -26,7 +26,7 @@ argfd(int n, int *pfd, struct file **pf)
 
   if(argint(n, &fd) < 0)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if(fd < 0 || fd >= NOFILE || (f=myproc()->group->ofile[fd]) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -37,18 +37,22 @@ argfd(int n, int *pfd, struct file **pf)
 
 // Allocate a file descriptor for the given file.
 // Takes over file reference from caller on success.
+// The group lock keeps two threads from taking the same slot.
 static int
 fdalloc(struct file *f)
 {
   int fd;
-  struct proc *p = myproc();
+  struct proc *p = myproc()->group;
 
+  acquire(&p->glock);
   for(fd = 0; fd < NOFILE; fd++){
     if(p->ofile[fd] == 0){
       p->ofile[fd] = f;
+      release(&p->glock);
       return fd;
     }
   }
+  release(&p->glock);
   return -1;
 }
 
@@ -96,10 +100,19 @@ sys_close(void)
 {
   int fd;
   struct file *f;
+  struct proc *p = myproc()->group;
 
-  if(argfd(0, &fd, &f) < 0)
+  if(argint(0, &fd) < 0 || fd < 0 || fd >= NOFILE)
     return -1;
-  myproc()->ofile[fd] = 0;
+  // take the file out of the table atomically, so two
+  // threads closing the same fd can't both fileclose() it.
+  acquire(&p->glock);
+  if((f = p->ofile[fd]) == 0){
+    release(&p->glock);
+    return -1;
+  }
+  p->ofile[fd] = 0;
+  release(&p->glock);
   fileclose(f);
   return 0;
 }
@@ -115,6 +128,30 @@ sys_fstat(void)
   return filestat(f, st);
 }
 
+uint64
+sys_getdents(void)
+{
+  struct file *f;
+  uint64 p;
+  int n;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0)
+    return -1;
+  return filereaddir(f, p, n, 0);
+}
+
+uint64
+sys_readdirplus(void)
+{
+  struct file *f;
+  uint64 p;
+  int n;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0)
+    return -1;
+  return filereaddir(f, p, n, 1);
+}
+
 // Create the path new as a link to the same inode as old.
 uint64
 sys_link(void)
@@ -322,6 +359,13 @@ sys_open(void)
     return -1;
   }
 
+  // a running program is read in as it runs; see lazyfault().
+  if((omode & (O_WRONLY|O_RDWR|O_TRUNC)) && ip->nexec > 0){
+    iunlockput(ip);
+    end_op();
+    return -1;
+  }
+
   if((f = filealloc()) == 0 || (fd = fdalloc(f)) < 0){
     if(f)
       fileclose(f);
@@ -392,7 +436,7 @@ sys_chdir(void)
 {
   char path[MAXPATH];
   struct inode *ip;
-  struct proc *p = myproc();
+  struct proc *p = myproc()->group;
   
   begin_op();
   if(argstr(0, path, MAXPATH) < 0 || (ip = namei(path)) == 0){
@@ -412,23 +456,23 @@ sys_chdir(void)
   return 0;
 }
 
-uint64
-sys_exec(void)
+// Copy the user argv array at uargv into argv[MAXARG],
+// one kalloc()ed page per string.
+// Returns 0 on success, -1 on error; either way the
+// caller must freeargv().
+static int
+fetchargv(uint64 uargv, char **argv)
 {
-  char path[MAXPATH], *argv[MAXARG];
   int i;
-  uint64 uargv, uarg;
+  uint64 uarg;
 
-  if(argstr(0, path, MAXPATH) < 0 || argaddr(1, &uargv) < 0){
-    return -1;
-  }
-  memset(argv, 0, sizeof(argv));
+  memset(argv, 0, MAXARG*sizeof(argv[0]));
   for(i=0;; i++){
-    if(i >= NELEM(argv)){
-      goto bad;
+    if(i >= MAXARG){
+      return -1;
     }
     if(fetchaddr(uargv+sizeof(uint64)*i, (uint64*)&uarg) < 0){
-      goto bad;
+      return -1;
     }
     if(uarg == 0){
       argv[i] = 0;
@@ -436,35 +480,88 @@ sys_exec(void)
     }
     argv[i] = kalloc();
     if(argv[i] == 0)
-      goto bad;
+      return -1;
     if(fetchstr(uarg, argv[i], PGSIZE) < 0)
-      goto bad;
+      return -1;
   }
+  return 0;
+}
 
-  int ret = exec(path, argv);
+static void
+freeargv(char **argv)
+{
+  int i;
 
-  for(i = 0; i < NELEM(argv) && argv[i] != 0; i++)
+  for(i = 0; i < MAXARG && argv[i] != 0; i++)
     kfree(argv[i]);
+}
 
-  return ret;
+uint64
+sys_exec(void)
+{
+  char path[MAXPATH], *argv[MAXARG];
+  uint64 uargv;
 
- bad:
-  for(i = 0; i < NELEM(argv) && argv[i] != 0; i++)
-    kfree(argv[i]);
-  return -1;
+  if(argstr(0, path, MAXPATH) < 0 || argaddr(1, &uargv) < 0){
+    return -1;
+  }
+  if(fetchargv(uargv, argv) < 0){
+    freeargv(argv);
+    return -1;
+  }
+
+  int ret = exec(path, argv);
+
+  freeargv(argv);
+  return ret;
 }
 
+// spawn(path, argv, fdmap): start path in a new child process.
+// fdmap, if non-zero, points to three ints naming the caller's
+// fds to use as the child's 0, 1 and 2 (-1 for closed), and no
+// other fds are inherited. if fdmap is zero, the child gets
+// all of the caller's open fds, as with fork.
 uint64
-sys_pipe(void)
+sys_spawn(void)
+{
+  char path[MAXPATH], *argv[MAXARG];
+  int i, fdmap[NOFILE], ufdmap[3];
+  uint64 uargv, uaddr;
+  struct proc *p = myproc()->group;
+
+  if(argstr(0, path, MAXPATH) < 0 || argaddr(1, &uargv) < 0 ||
+     argaddr(2, &uaddr) < 0){
+    return -1;
+  }
+  for(i = 0; i < NOFILE; i++)
+    fdmap[i] = (uaddr == 0 && p->ofile[i]) ? i : -1;
+  if(uaddr != 0){
+    if(copyin(p->pagetable, (char*)ufdmap, uaddr, sizeof(ufdmap)) < 0)
+      return -1;
+    for(i = 0; i < NELEM(ufdmap); i++)
+      fdmap[i] = ufdmap[i];
+  }
+  if(fetchargv(uargv, argv) < 0){
+    freeargv(argv);
+    return -1;
+  }
+
+  int ret = spawn(path, argv, fdmap);
+
+  freeargv(argv);
+  return ret;
+}
+
+// make a pipe of at least size bytes, storing its
+// read and write fds at user address fdarray.
+static int
+mkpipe(uint64 fdarray, int size)
 {
-  uint64 fdarray; // user pointer to array of two integers
   struct file *rf, *wf;
   int fd0, fd1;
-  struct proc *p = myproc();
+  struct proc *p = myproc()->group;
 
-  if(argaddr(0, &fdarray) < 0)
-    return -1;
-  if(pipealloc(&rf, &wf) < 0)
+  if(pipealloc(&rf, &wf, size) < 0)
     return -1;
   fd0 = -1;
   if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
@@ -484,3 +581,26 @@ sys_pipe(void)
   }
   return 0;
 }
+
+uint64
+sys_pipe(void)
+{
+  uint64 fdarray; // user pointer to array of two integers
+
+  if(argaddr(0, &fdarray) < 0)
+    return -1;
+  return mkpipe(fdarray, 0);
+}
+
+// pipe2(fdarray, size): a pipe whose buffer holds at least
+// size bytes, up to 64KB, rather than the usual 512.
+uint64
+sys_pipe2(void)
+{
+  uint64 fdarray;
+  int size;
+
+  if(argaddr(0, &fdarray) < 0 || argint(1, &size) < 0)
+    return -1;
+  return mkpipe(fdarray, size);
+}
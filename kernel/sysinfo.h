@@ -1,4 +1,30 @@
+// What sysinfo2(info, size) reports; the kernel fills in
+// up to size bytes. sysinfo(info) fills in version 1,
+// freemem and nproc, alone.
+
+#define SYSINFO_VERSION 2
+#define SYSINFO_NCPU 8      // at least NCPU
+
+struct cpuinfo {
+  uint64 busy;      // time running processes, in time CSR ticks
+  uint64 idle;      // time not running processes
+  uint64 nswitch;   // switches to processes
+};
+
 struct sysinfo {
   uint64 freemem;   // amount of free memory (bytes)
   uint64 nproc;     // number of process
+  // version 2:
+  uint64 version;   // SYSINFO_VERSION
+  uint64 size;      // sizeof(struct sysinfo), in the kernel
+  uint64 totalmem;  // bytes of memory in all
+  uint64 nrunnable; // processes waiting for a cpu
+  uint64 time;      // time CSR
+  uint64 ncpu;      // harts running the scheduler
+  uint64 bhit;      // block reads found in the buffer cache
+  uint64 bmiss;     // and not
+  uint64 ncommit;   // log transactions committed
+  uint64 nread;     // disk reads
+  uint64 nwrite;    // disk writes
+  struct cpuinfo cpu[SYSINFO_NCPU];
 };
@@ -0,0 +1,48 @@
+// System call names, for tracing; indexed by number.
+// Included by the kernel and by user/tracedump.c.
+
+static char *syscall_name[] = {
+[SYS_fork] = "fork",
+[SYS_exit] = "exit",
+[SYS_wait] = "wait",
+[SYS_pipe] = "pipe",
+[SYS_read] = "read",
+[SYS_kill] = "kill",
+[SYS_exec] = "exec",
+[SYS_fstat] = "fstat",
+[SYS_chdir] = "chdir",
+[SYS_dup]   = "dup",
+[SYS_getpid] = "getpid",
+[SYS_sbrk]   = "sbrk",
+[SYS_sleep]  = "sleep",
+[SYS_uptime] = "uptime",
+[SYS_open]   = "open",
+[SYS_write]  = "write",
+[SYS_mknod]  = "mknod",
+[SYS_unlink] = "unlink",
+[SYS_link]   = "link",
+[SYS_mkdir]  = "mkdir",
+[SYS_close]  = "close",
+[SYS_trace]  = "trace",
+[SYS_sysinfo] = "sysinfo",
+[SYS_spawn]  = "spawn",
+[SYS_clone]  = "clone",
+[SYS_futex_wait] = "futex_wait",
+[SYS_futex_wake] = "futex_wake",
+[SYS_nanosleep] = "nanosleep",
+[SYS_clock_gettime] = "clock_gettime",
+[SYS_traceread] = "traceread",
+[SYS_sysstat] = "sysstat",
+[SYS_prof]   = "prof",
+[SYS_profread] = "profread",
+[SYS_getdents] = "getdents",
+[SYS_readdirplus] = "readdirplus",
+[SYS_pipe2] = "pipe2",
+[SYS_sysinfo2] = "sysinfo2",
+#ifdef LAB_NET
+[SYS_connect] = "connect",
+#endif
+#ifdef LAB_PGTBL
+[SYS_pgaccess] = "pgaccess",
+#endif
+};
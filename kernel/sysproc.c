@@ -8,6 +8,10 @@
 #include "proc.h"
 #include "sysinfo.h"
 
+#if NCPU > SYSINFO_NCPU
+#error "struct sysinfo has too few cpus"
+#endif
+
 uint64
 sys_exit(void)
 {
@@ -30,6 +34,38 @@ sys_fork(void)
   return fork();
 }
 
+uint64
+sys_clone(void)
+{
+  uint64 fn, arg, stack;
+
+  if(argaddr(0, &fn) < 0 || argaddr(1, &arg) < 0 || argaddr(2, &stack) < 0)
+    return -1;
+  return clone(fn, arg, stack);
+}
+
+uint64
+sys_futex_wait(void)
+{
+  uint64 addr;
+  int val;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futexwait(addr, val);
+}
+
+uint64
+sys_futex_wake(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return futexwake(addr, n);
+}
+
 uint64
 sys_wait(void)
 {
@@ -48,7 +84,7 @@ sys_sbrk(void)
   if(argint(0, &n) < 0)
     return -1;
   
-  addr = myproc()->sz;
+  addr = myproc()->group->sz;
   if(growproc(n) < 0)
     return -1;
   return addr;
@@ -58,21 +94,36 @@ uint64
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
-
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
+  if(n <= 0)
+    return 0;
+  return timersleep(r_time() + n * TICKCYCLES);
+}
+
+// sleep for a number of nanoseconds.
+uint64
+sys_nanosleep(void)
+{
+  uint64 ns;
+
+  if(argaddr(0, &ns) < 0)
+    return -1;
+  return timersleep(r_time() + ns / (1000000000L / TIMEFREQ));
+}
+
+// nanoseconds since boot, from the time CSR.
+uint64
+sys_clock_gettime(void)
+{
+  uint64 addr, ns;
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  ns = r_time() * (1000000000L / TIMEFREQ);
+  if(copyout(myproc()->pagetable, addr, (char *)&ns, sizeof(ns)) < 0)
+    return -1;
   return 0;
 }
 
@@ -129,17 +180,12 @@ sys_kill(void)
   return kill(pid);
 }
 
-// return how many clock tick interrupts have occurred
+// return how many scheduling ticks have passed
 // since start.
 uint64
 sys_uptime(void)
 {
-  uint xticks;
-
-  acquire(&tickslock);
-  xticks = ticks;
-  release(&tickslock);
-  return xticks;
+  return r_time() / TICKCYCLES;
 }
 
 uint64
@@ -153,25 +199,117 @@ sys_trace(void)
   return 0;
 }
 
-uint64 
-sys_sysinfo(void) 
-{ 
+// copy up to n trace records to the user buffer.
+uint64
+sys_traceread(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return traceread(addr, n);
+}
+
+// copy per-syscall statistics to the user's
+// struct sysstat[NSYSCALL].
+uint64
+sys_sysstat(void)
+{
+  int which, id;
   uint64 addr;
-  struct sysinfo *p_info;
-  struct proc *p = myproc();
 
-  if(argaddr(0, &addr) < 0) 
+  if(argint(0, &which) < 0 || argint(1, &id) < 0 || argaddr(2, &addr) < 0)
     return -1;
-  p_info = (struct sysinfo*) addr; 
-  
-  uint64 freemem = kfreenum();
-  uint64 nproc   = procnum();
+  return sysstatread(which, id, addr);
+}
 
-  if(copyout(p->pagetable, (uint64)&p_info->freemem, (char*)&freemem, sizeof(freemem)) < 0) {
+// sample pcs hz times a second; 0 stops.
+uint64
+sys_prof(void)
+{
+  int hz;
+
+  if(argint(0, &hz) < 0)
     return -1;
-  }
-  if(copyout(p->pagetable, (uint64)&p_info->nproc, (char*)&nproc, sizeof(nproc)) < 0) {
+  return profstart(hz);
+}
+
+// copy up to n profiling samples to the user buffer.
+uint64
+sys_profread(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
     return -1;
+  return profread(addr, n);
+}
+
+// copy out the first size bytes of a struct sysinfo to addr.
+static int
+sysinfo(uint64 addr, int size)
+{
+  uint64 now, t;
+  int i;
+  struct sysinfo info;
+  struct cpu *c;
+
+  memset(&info, 0, sizeof(info));
+  info.freemem = kfreenum();
+  info.nproc = procnum();
+  info.version = SYSINFO_VERSION;
+  info.size = sizeof(info);
+  info.totalmem = ktotalnum();
+  info.nrunnable = procrunnable();
+  info.time = now = r_time();
+  for(i = 0; i < NCPU; i++){
+    c = &cpus[i];
+    if(c->start == 0)
+      continue;
+    info.ncpu++;
+    // a snapshot, without locks.
+    info.cpu[i].busy = c->busy;
+    if((t = c->runstart) != 0 && t < now)
+      info.cpu[i].busy += now - t;
+    if(info.cpu[i].busy > now - c->start)
+      info.cpu[i].busy = now - c->start;
+    info.cpu[i].idle = now - c->start - info.cpu[i].busy;
+    info.cpu[i].nswitch = c->nswitch;
   }
+  bstats(&info.bhit, &info.bmiss);
+  info.ncommit = logcommits();
+  diskstats(&info.nread, &info.nwrite);
+
+  if(size > sizeof(info))
+    size = sizeof(info);
+  if(copyout(myproc()->pagetable, addr, (char*)&info, size) < 0)
+    return -1;
   return 0;
-}
\ No newline at end of file
+}
+
+// sysinfo(info): the original call, which fills in
+// freemem and nproc and nothing else.
+uint64
+sys_sysinfo(void)
+{
+  uint64 addr;
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  return sysinfo(addr, 2 * sizeof(uint64));
+}
+
+// sysinfo2(info, size): fill in up to size bytes of
+// the current struct sysinfo.
+uint64
+sys_sysinfo2(void)
+{
+  uint64 addr;
+  int size;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &size) < 0 || size < 0)
+    return -1;
+  return sysinfo(addr, size);
+}
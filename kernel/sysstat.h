@@ -0,0 +1,20 @@
+// Per-syscall counts and latencies, kept by syscall() for
+// each hart and each process, and returned by sysstat().
+// Latencies are in cycles; hist[i] counts calls that took
+// less than 2^(i+HISTSHIFT) cycles, except the last, which
+// counts the rest.
+
+#define NSYSCALL  48  // more than the highest syscall number
+#define NHIST     16
+#define HISTSHIFT 8
+
+struct sysstat {
+  uint64 count;
+  uint64 cycles;     // total latency
+  uint hist[NHIST];
+};
+
+// sysstat(which, id, st) fills st[NSYSCALL] with:
+#define SS_ALL  0  // the sum over all harts
+#define SS_CPU  1  // hart id's
+#define SS_PROC 2  // process id's
@@ -0,0 +1,192 @@
+// Timer deadlines.
+//
+// Processes sleeping until some time (sleep(), nanosleep())
+// each put a struct timer on their kernel stack into a
+// min-heap ordered by deadline. Harts don't take a timer
+// interrupt every tick any more: timerarm() programs each
+// hart's mtimecmp for the earliest deadline, and, while the
+// hart runs a process, for no later than the end of the
+// process's time slice. An idle hart sleeps in wfi until
+// then, or until kickidle() pokes it.
+//
+// Times are in units of the time CSR (mtime), TIMEFREQ per second.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+struct timer {
+  uint64 when;                // deadline
+  int fired;
+  int i;                      // index in timers.heap
+};
+
+struct {
+  struct spinlock lock;
+  struct timer *heap[NPROC];  // each process sleeps on at most one
+  int n;
+} timers;
+
+void
+timersinit(void)
+{
+  initmcslock(&timers.lock, "timers");
+}
+
+static void
+swap(int i, int j)
+{
+  struct timer *t = timers.heap[i];
+
+  timers.heap[i] = timers.heap[j];
+  timers.heap[j] = t;
+  timers.heap[i]->i = i;
+  timers.heap[j]->i = j;
+}
+
+static void
+siftup(int i)
+{
+  while(i > 0 && timers.heap[(i-1)/2]->when > timers.heap[i]->when){
+    swap(i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+static void
+siftdown(int i)
+{
+  int c;
+
+  for(;;){
+    c = 2*i + 1;
+    if(c >= timers.n)
+      break;
+    if(c+1 < timers.n && timers.heap[c+1]->when < timers.heap[c]->when)
+      c++;
+    if(timers.heap[i]->when <= timers.heap[c]->when)
+      break;
+    swap(i, c);
+    i = c;
+  }
+}
+
+// take timers.heap[i] out of the heap.
+static void
+heapremove(int i)
+{
+  timers.n--;
+  if(i == timers.n)
+    return;
+  timers.heap[i] = timers.heap[timers.n];
+  timers.heap[i]->i = i;
+  siftup(i);
+  siftdown(timers.heap[i]->i);
+}
+
+// Program this hart's next timer interrupt for the earliest
+// deadline, for the next profiling sample if the profiler is
+// on, and, if busy (running a process), for no later than
+// the end of its time slice.
+void
+timerarm(int busy)
+{
+  struct cpu *c;
+  uint64 when = ~0L;
+  uint64 now, t;
+
+  push_off();
+  c = mycpu();
+  acquire(&timers.lock);
+  if(timers.n > 0)
+    when = timers.heap[0]->when;
+  release(&timers.lock);
+  now = r_time();
+  if(busy){
+    if(c->sliceend <= now)
+      c->sliceend = now + TICKCYCLES;
+    if(c->sliceend < when)
+      when = c->sliceend;
+  }
+  if((t = profdue(now)) < when)
+    when = t;
+  c->timer = when;
+  *(uint64*)CLINT_MTIMECMP(cpuid()) = when;
+  pop_off();
+}
+
+// Start a time slice for the process this hart is about to
+// run, and make sure the timer goes off at its end. Called
+// by scheduler() with a p->lock held, so it can't take
+// timers.lock; it only ever moves the interrupt earlier, so
+// it doesn't need to look at the heap.
+void
+timerslice(void)
+{
+  struct cpu *c = mycpu();
+  uint64 when = r_time() + TICKCYCLES;
+
+  c->sliceend = when;
+  if(c->timer > when){
+    c->timer = when;
+    *(uint64*)CLINT_MTIMECMP(cpuid()) = when;
+  }
+}
+
+// Wake the processes whose deadlines have passed, and
+// return how many there were.
+// Called from clockintr() on every hart.
+int
+timerfire(void)
+{
+  struct timer *t;
+  uint64 now = r_time();
+  int n = 0;
+
+  acquire(&timers.lock);
+  while(timers.n > 0 && timers.heap[0]->when <= now){
+    t = timers.heap[0];
+    heapremove(0);
+    t->fired = 1;
+    wakeup(t);
+    n++;
+  }
+  release(&timers.lock);
+  return n;
+}
+
+// Sleep until the time CSR reaches when.
+// Returns 0, or -1 if the process was killed first.
+int
+timersleep(uint64 when)
+{
+  struct timer t;
+  struct proc *p = myproc();
+
+  if(when <= r_time())
+    return 0;
+
+  acquire(&timers.lock);
+  t.when = when;
+  t.fired = 0;
+  t.i = timers.n++;
+  timers.heap[t.i] = &t;
+  siftup(t.i);
+  release(&timers.lock);
+
+  // the earliest deadline may have changed; this hart
+  // is running p, so it is busy until p sleeps.
+  timerarm(1);
+
+  acquire(&timers.lock);
+  while(!t.fired && !p->killed)
+    sleep(&t, &timers.lock);
+  if(!t.fired)
+    heapremove(t.i);
+  release(&timers.lock);
+  return t.fired ? 0 : -1;
+}
@@ -0,0 +1,101 @@
+// Syscall tracing.
+//
+// syscall() hands each traced call to tracerecord(), which
+// appends a binary record to the running hart's ring. A ring
+// has one writer, its hart, with interrupts off, and one
+// reader, traceread() under trace.lock; so the syscall path
+// takes no lock and never waits. A full ring drops new
+// records and counts them, to be reported by the reader.
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "trace.h"
+#include "defs.h"
+
+#define NTRACE 1024  // records per hart
+
+struct ring {
+  struct tracerec rec[NTRACE];
+  uint64 head;  // records written; advanced by the hart
+  uint64 tail;  // records read; advanced by traceread()
+  uint64 lost;  // records dropped since the last read
+};
+
+static struct {
+  struct spinlock lock;  // serializes readers
+  struct ring ring[NCPU];
+} trace;
+
+void
+traceinit(void)
+{
+  initlock(&trace.lock, "trace");
+}
+
+void
+tracerecord(struct tracerec *r)
+{
+  struct ring *rg;
+  uint64 h;
+
+  push_off();
+  rg = &trace.ring[cpuid()];
+  h = rg->head;
+  if(h - __atomic_load_n(&rg->tail, __ATOMIC_ACQUIRE) == NTRACE){
+    __atomic_fetch_add(&rg->lost, 1, __ATOMIC_RELAXED);
+  } else {
+    r->cpu = cpuid();
+    rg->rec[h % NTRACE] = *r;
+    __atomic_store_n(&rg->head, h + 1, __ATOMIC_RELEASE);
+  }
+  pop_off();
+}
+
+// Copy up to n records, oldest first hart by hart, to user
+// address dst, taking them out of the rings. A hart that
+// dropped records first yields a record with num 0 and the
+// count in ret. Returns the number of records copied.
+int
+traceread(uint64 dst, int n)
+{
+  struct ring *rg;
+  struct tracerec lost;
+  uint64 h, t;
+  int i, got;
+
+  if(n <= 0)
+    return 0;
+  // copying out under trace.lock mustn't have to page
+  // anything in from disk.
+  lazytouch(dst, (uint64)n * sizeof(struct tracerec));
+  acquire(&trace.lock);
+
+  got = 0;
+  for(i = 0; i < NCPU && got < n; i++){
+    rg = &trace.ring[i];
+    if(__atomic_load_n(&rg->lost, __ATOMIC_RELAXED) != 0){
+      memset(&lost, 0, sizeof(lost));
+      lost.cpu = i;
+      lost.ret = __atomic_exchange_n(&rg->lost, 0, __ATOMIC_RELAXED);
+      if(either_copyout(1, dst, &lost, sizeof(lost)) == -1)
+        break;
+      dst += sizeof(lost);
+      got++;
+    }
+    h = __atomic_load_n(&rg->head, __ATOMIC_ACQUIRE);
+    for(t = rg->tail; t != h && got < n; t++){
+      if(either_copyout(1, dst, &rg->rec[t % NTRACE], sizeof(struct tracerec)) == -1)
+        break;
+      dst += sizeof(struct tracerec);
+      got++;
+    }
+    __atomic_store_n(&rg->tail, t, __ATOMIC_RELEASE);
+    if(t != h && got < n)
+      break;  // copyout failed
+  }
+
+  release(&trace.lock);
+  return got;
+}
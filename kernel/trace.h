@@ -0,0 +1,11 @@
+// One traced system call, as recorded by syscall()
+// and returned by traceread().
+struct tracerec {
+  uint64 time;     // time CSR at entry, comparable across harts
+  uint64 cycle;    // cycle counter of the hart, at entry
+  uint64 arg[4];   // a0-a3 at entry
+  uint64 ret;      // return value; for a lost record, the count
+  int pid;
+  short num;       // syscall number, or 0 for a lost record
+  short cpu;
+};
@@ -6,9 +6,6 @@
 #include "proc.h"
 #include "defs.h"
 
-struct spinlock tickslock;
-uint ticks;
-
 extern char trampoline[], uservec[], userret[];
 
 // in kernelvec.S, calls kerneltrap().
@@ -16,12 +13,6 @@ void kernelvec();
 
 extern int devintr();
 
-void
-trapinit(void)
-{
-  initlock(&tickslock, "time");
-}
-
 // set up to take exceptions and traps while in the kernel.
 void
 trapinithart(void)
@@ -66,7 +57,18 @@ usertrap(void)
 
     syscall();
   } else if((which_dev = devintr()) != 0){
-    // ok
+    if(which_dev >= 2)
+      profsample(1, p->trapframe->epc, 0, 0);
+  } else if(r_scause() == 12 || r_scause() == 13 || r_scause() == 15){
+    // instruction, load or store page fault. it may be a
+    // lazily loaded exec page, which has to be read from
+    // disk, so allow interrupts while it is paged in.
+    intr_on();
+    if(lazyfault(p->pagetable, r_stval()) < 0){
+      printf("usertrap(): page fault %p pid=%d\n", r_scause(), p->pid);
+      printf("            sepc=%p stval=%p\n", r_sepc(), r_stval());
+      p->killed = 1;
+    }
   } else {
     printf("usertrap(): unexpected scause %p pid=%d\n", r_scause(), p->pid);
     printf("            sepc=%p stval=%p\n", r_sepc(), r_stval());
@@ -125,7 +127,7 @@ usertrapret(void)
   // switches to the user page table, restores user registers,
   // and switches to user mode with sret.
   uint64 fn = TRAMPOLINE + (userret - trampoline);
-  ((void (*)(uint64,uint64))fn)(TRAPFRAME, satp);
+  ((void (*)(uint64,uint64))fn)(p->tfva, satp);
 }
 
 // interrupts and exceptions from kernel code go here via kernelvec,
@@ -149,6 +151,14 @@ kerneltrap()
     panic("kerneltrap");
   }
 
+  if(which_dev >= 2){
+    // kernelvec saved the interrupted code's registers at
+    // the bottom of its frame, which starts where our frame
+    // pointer points; s0 is at offset 56.
+    uint64 frame = r_fp();
+    profsample(0, sepc, ((uint64*)frame)[7], frame + 256);
+  }
+
   // give up the CPU if this is a timer interrupt.
   if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
     yield();
@@ -159,18 +169,25 @@ kerneltrap()
   w_sstatus(sstatus);
 }
 
-void
+// returns whether the running process should yield: its
+// time slice is over, or a sleeper has woken up. otherwise
+// the interrupt was only for the profiler.
+int
 clockintr()
 {
-  acquire(&tickslock);
-  ticks++;
-  wakeup(&ticks);
-  release(&tickslock);
+  int woke, over;
+
+  vdatatick();
+  woke = timerfire();
+  over = r_time() >= mycpu()->sliceend;
+  timerarm(myproc() != 0);
+  return woke || over;
 }
 
 // check if it's an external interrupt or software interrupt,
 // and handle it.
-// returns 2 if timer interrupt,
+// returns 2 if timer interrupt that should end the time
+// slice, 3 if other timer interrupt,
 // 1 if other device,
 // 0 if not recognized.
 int
@@ -204,15 +221,12 @@ devintr()
     // software interrupt from a machine-mode timer interrupt,
     // forwarded by timervec in kernelvec.S.
 
-    if(cpuid() == 0){
-      clockintr();
-    }
-    
     // acknowledge the software interrupt by clearing
-    // the SSIP bit in sip.
+    // the SSIP bit in sip, before clockintr() arms the
+    // next one.
     w_sip(r_sip() & ~2);
 
-    return 2;
+    return clockintr() ? 2 : 3;
   } else {
     return 0;
   }
@@ -38,12 +38,15 @@
 #define ReadReg(reg) (*(Reg(reg)))
 #define WriteReg(reg, v) (*(Reg(reg)) = (v))
 
+#define UART_FIFO 16          // depth of the transmit FIFO
+
 // the transmit output buffer.
 struct spinlock uart_tx_lock;
-#define UART_TX_BUF_SIZE 32
+#define UART_TX_BUF_SIZE 1024
 char uart_tx_buf[UART_TX_BUF_SIZE];
 uint64 uart_tx_w; // write next to uart_tx_buf[uart_tx_w % UART_TX_BUF_SIZE]
 uint64 uart_tx_r; // read next from uart_tx_buf[uart_tx_r % UART_TX_BUF_SIZE]
+int uart_tx_waiting; // number of writers asleep on a full buffer
 
 extern volatile int panicked; // from printf.c
 
@@ -77,15 +80,34 @@ uartinit(void)
   initlock(&uart_tx_lock, "uart");
 }
 
-// add a character to the output buffer and tell the
+// copy as much of s[0..n-1] as fits into the output
+// buffer; return how much that was.
+// caller must hold uart_tx_lock.
+static int
+uartfill(char *s, int n)
+{
+  int i, m;
+
+  m = UART_TX_BUF_SIZE - (uart_tx_w - uart_tx_r);
+  if(m > n)
+    m = n;
+  for(i = 0; i < m; i++)
+    uart_tx_buf[(uart_tx_w + i) % UART_TX_BUF_SIZE] = s[i];
+  uart_tx_w += m;
+  return m;
+}
+
+// add n characters to the output buffer and tell the
 // UART to start sending if it isn't already.
-// blocks if the output buffer is full.
+// blocks while the output buffer is full.
 // because it may block, it can't be called
 // from interrupts; it's only suitable for use
 // by write().
 void
-uartputc(int c)
+uartwrite(char *s, int n)
 {
+  int m;
+
   acquire(&uart_tx_lock);
 
   if(panicked){
@@ -93,23 +115,67 @@ uartputc(int c)
       ;
   }
 
-  while(1){
-    if(uart_tx_w == uart_tx_r + UART_TX_BUF_SIZE){
+  while(n > 0){
+    m = uartfill(s, n);
+    s += m;
+    n -= m;
+    uartstart();
+    if(n > 0){
       // buffer is full.
       // wait for uartstart() to open up space in the buffer.
+      uart_tx_waiting++;
       sleep(&uart_tx_r, &uart_tx_lock);
-    } else {
-      uart_tx_buf[uart_tx_w % UART_TX_BUF_SIZE] = c;
-      uart_tx_w += 1;
+      uart_tx_waiting--;
+    }
+  }
+  release(&uart_tx_lock);
+}
+
+// like uartwrite(), but never sleeps: if the buffer fills
+// up, wait for the UART to drain it. for kernel printf(),
+// which may be called with locks held or from interrupts.
+void
+uartputs(char *s, int n)
+{
+  int m;
+
+  acquire(&uart_tx_lock);
+
+  if(panicked){
+    for(;;)
+      ;
+  }
+
+  while(n > 0){
+    m = uartfill(s, n);
+    s += m;
+    n -= m;
+    uartstart();
+    if(n > 0){
+      while((ReadReg(LSR) & LSR_TX_IDLE) == 0)
+        ;
       uartstart();
-      release(&uart_tx_lock);
-      return;
     }
   }
+  release(&uart_tx_lock);
 }
 
-// alternate version of uartputc() that doesn't 
-// use interrupts, for use by kernel printf() and
+// send whatever is in the output buffer, without locking
+// or interrupts, so that panic() doesn't lose the output
+// that led up to it.
+void
+uartdrain(void)
+{
+  while(uart_tx_r != uart_tx_w){
+    while((ReadReg(LSR) & LSR_TX_IDLE) == 0)
+      ;
+    WriteReg(THR, uart_tx_buf[uart_tx_r % UART_TX_BUF_SIZE]);
+    uart_tx_r += 1;
+  }
+}
+
+// alternate version of uartwrite() for one character
+// that doesn't use interrupts, for use by panic() and
 // to echo characters. it spins waiting for the uart's
 // output register to be empty.
 void
@@ -130,34 +196,34 @@ uartputc_sync(int c)
   pop_off();
 }
 
-// if the UART is idle, and a character is waiting
-// in the transmit buffer, send it.
+// if the UART's transmit FIFO is empty, and characters are
+// waiting in the transmit buffer, refill the FIFO.
 // caller must hold uart_tx_lock.
 // called from both the top- and bottom-half.
 void
 uartstart()
 {
-  while(1){
-    if(uart_tx_w == uart_tx_r){
-      // transmit buffer is empty.
-      return;
-    }
-    
-    if((ReadReg(LSR) & LSR_TX_IDLE) == 0){
-      // the UART transmit holding register is full,
-      // so we cannot give it another byte.
-      // it will interrupt when it's ready for a new byte.
-      return;
-    }
-    
-    int c = uart_tx_buf[uart_tx_r % UART_TX_BUF_SIZE];
+  int i;
+
+  if(uart_tx_w == uart_tx_r){
+    // transmit buffer is empty.
+    return;
+  }
+
+  if((ReadReg(LSR) & LSR_TX_IDLE) == 0){
+    // the UART is still sending what it has.
+    // it will interrupt when its FIFO is empty.
+    return;
+  }
+
+  for(i = 0; i < UART_FIFO && uart_tx_r != uart_tx_w; i++){
+    WriteReg(THR, uart_tx_buf[uart_tx_r % UART_TX_BUF_SIZE]);
     uart_tx_r += 1;
-    
-    // maybe uartputc() is waiting for space in the buffer.
-    wakeup(&uart_tx_r);
-    
-    WriteReg(THR, c);
   }
+
+  // maybe uartwrite() is waiting for space in the buffer.
+  if(uart_tx_waiting)
+    wakeup(&uart_tx_r);
 }
 
 // read one input character from the UART.
@@ -0,0 +1,78 @@
+// The kernel's shared data page, mapped read-only at VDATA
+// in every process (see memlayout.h). Together with the time
+// CSR, which user code may read too, it lets user/ulib.c
+// answer uptime() and clock_gettime() without a trap; and
+// getpid() reads the per-process USYSCALL page.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "defs.h"
+
+static struct spinlock vdlock;  // serializes updates
+static struct vdata *vd;
+
+void
+vdatainit(void)
+{
+  initlock(&vdlock, "vdata");
+  if((vd = (struct vdata *)kalloc()) == 0)
+    panic("vdatainit");
+  memset(vd, 0, PGSIZE);
+  vd->tickcycles = TICKCYCLES;
+  vd->timebase = 0;
+  vd->timefreq = TIMEFREQ;
+  vd->version = VDATA_VERSION;
+}
+
+uint64
+vdatapage(void)
+{
+  return (uint64)vd;
+}
+
+static void
+begin(void)
+{
+  acquire(&vdlock);
+  vd->seq++;
+  __sync_synchronize();
+}
+
+static void
+end(void)
+{
+  __sync_synchronize();
+  vd->seq++;
+  release(&vdlock);
+}
+
+// Count this hart, and let user code read the time
+// and cycle counters.
+void
+vdatainithart(void)
+{
+  w_scounteren(r_scounteren() | 1 | 2);
+  begin();
+  vd->ncpu++;
+  end();
+}
+
+// Called from clockintr(); harts no longer take an interrupt
+// every tick, so readers also add the ticks since stamp.
+void
+vdatatick(void)
+{
+  uint64 ticks = r_time() / TICKCYCLES;
+
+  if(ticks == vd->ticks)
+    return;
+  begin();
+  if(ticks > vd->ticks){
+    vd->ticks = ticks;
+    vd->stamp = ticks * TICKCYCLES;
+  }
+  end();
+}
@@ -70,6 +70,9 @@ static struct disk {
   struct virtio_blk_req ops[NUM];
   
   struct spinlock vdisk_lock;
+
+  uint64 nread;   // operations started
+  uint64 nwrite;
   
 } __attribute__ ((aligned (PGSIZE))) disk;
 
@@ -206,6 +209,10 @@ virtio_disk_rw(struct buf *b, int write)
   uint64 sector = b->blockno * (BSIZE / 512);
 
   acquire(&disk.vdisk_lock);
+  if(write)
+    disk.nwrite++;
+  else
+    disk.nread++;
 
   // the spec's Section 5.2 says that legacy block operations use
   // three descriptors: one for type/reserved/sector, one for the
@@ -313,3 +320,10 @@ virtio_disk_intr()
 
   release(&disk.vdisk_lock);
 }
+
+void
+diskstats(uint64 *nread, uint64 *nwrite)
+{
+  *nread = disk.nread;
+  *nwrite = disk.nwrite;
+}
@@ -0,0 +1,136 @@
+// malloc() stress benchmark: each of nthreads threads keeps
+// a table of blocks and, iters times, frees a random entry
+// if it is in use or allocates a random size into it if not.
+// Reports operations per second, and how much heap that took
+// compared with the bytes the threads held at the end; then
+// how much heap is left once everything has been freed.
+//
+// usage: allocbench [-t nthreads] [-n iters]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define MAXT 8
+#define MAXSLOT 1000
+
+struct workload {
+  char *name;
+  uint min, max;  // block sizes
+  int nslot;
+} workloads[] = {
+  { "small", 8, 256, 1000 },
+  { "mixed", 8, 8192, 500 },
+  { "large", 4096, 65536, 64 },
+};
+
+struct worker {
+  struct workload *w;
+  char *p[MAXSLOT];
+  uint n[MAXSLOT];
+  uint64 live;
+  int failed;
+} workers[MAXT];
+
+int nthread, iters;
+char *start;       // the heap's bottom
+
+void
+work(void *arg)
+{
+  struct worker *k = arg;
+  struct workload *w = k->w;
+  uint seed = (uint)(uint64)arg;
+  uint i, n;
+
+  for(int it = 0; it < iters; it++){
+    seed = seed * 1103515245 + 12345;
+    i = (seed >> 8) % w->nslot;
+    if(k->p[i]){
+      if(k->p[i][0] != (char)i || k->p[i][k->n[i]-1] != (char)i)
+        k->failed = 1;
+      free(k->p[i]);
+      k->p[i] = 0;
+      k->live -= k->n[i];
+      continue;
+    }
+    seed = seed * 1103515245 + 12345;
+    n = w->min + (seed >> 8) % (w->max - w->min + 1);
+    if((k->p[i] = malloc(n)) == 0){
+      k->failed = 1;
+      return;
+    }
+    k->p[i][0] = k->p[i][n-1] = i;
+    k->n[i] = n;
+    k->live += n;
+  }
+}
+
+void
+run(struct workload *w)
+{
+  int i, j, tid[MAXT];
+  uint64 t0, t1, live;
+  char *top;
+
+  clock_gettime(&t0);
+  for(i = 0; i < nthread; i++){
+    memset(&workers[i], 0, sizeof(workers[i]));
+    workers[i].w = w;
+    if((tid[i] = thread_create(work, &workers[i])) < 0){
+      fprintf(2, "allocbench: thread_create failed\n");
+      exit(1);
+    }
+  }
+  for(i = 0; i < nthread; i++)
+    thread_join(tid[i]);
+  clock_gettime(&t1);
+
+  live = 0;
+  for(i = 0; i < nthread; i++){
+    if(workers[i].failed){
+      fprintf(2, "allocbench: %s: malloc failed or corrupted a block\n", w->name);
+      exit(1);
+    }
+    live += workers[i].live;
+  }
+  top = sbrk(0);
+  for(i = 0; i < nthread; i++)
+    for(j = 0; j < w->nslot; j++)
+      free(workers[i].p[j]);
+
+  printf("%s (%d-%d bytes): ", w->name, w->min, w->max);
+  if(t1 > t0)
+    printf("%l ops/s, ", persec((uint64)nthread * iters, t1 - t0));
+  printf("%l KB live in %l KB heap", live / 1024, (uint64)(top - start) / 1024);
+  if(live > 0)
+    printf(" (%l%%)", (uint64)(top - start) * 100 / live);
+  printf(", %l KB after freeing\n", (uint64)(sbrk(0) - start) / 1024);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i;
+
+  nthread = 1;
+  iters = 100000;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-t") == 0)
+      nthread = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-n") == 0)
+      iters = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i < argc || nthread <= 0 || nthread > MAXT || iters <= 0){
+    fprintf(2, "usage: allocbench [-t nthreads] [-n iters]\n");
+    exit(1);
+  }
+
+  start = sbrk(0);
+  printf("allocbench: %d threads x %d iters\n", nthread, iters);
+  for(i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++)
+    run(&workloads[i]);
+  exit(0);
+}
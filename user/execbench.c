@@ -0,0 +1,64 @@
+// Measure exec() start-up latency by forking and exec'ing
+// a program over and over.
+//
+// usage: execbench [-n iters] [prog [arg ...]]
+//
+// The default runs "usertests -", a large binary that prints
+// its usage message and exits right away, so the cost is
+// dominated by exec itself and by the pages touched on the way.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+#define USPERTICK 100000  // timerinit(): 1000000 cycles at 10MHz
+
+char *defargv[] = { "usertests", "-", 0 };
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, pid, xstatus, t0, t;
+  char **cmd;
+
+  n = 200;
+  if(argc > 2 && strcmp(argv[1], "-n") == 0){
+    n = atoi(argv[2]);
+    argc -= 2;
+    argv += 2;
+  }
+  cmd = argc > 1 ? argv + 1 : defargv;
+  if(n <= 0){
+    fprintf(2, "usage: execbench [-n iters] [prog [arg ...]]\n");
+    exit(1);
+  }
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "execbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      // keep the program's output out of the way.
+      close(1);
+      close(2);
+      exec(cmd[0], cmd);
+      exit(127);
+    }
+    wait(&xstatus);
+    if(xstatus == 127){
+      fprintf(2, "execbench: exec %s failed\n", cmd[0]);
+      exit(1);
+    }
+  }
+  t = uptime() - t0;
+
+  printf("execbench: %d execs of %s in %d ticks", n, cmd[0], t);
+  if(t > 0)
+    printf(", %d us/exec", t * USPERTICK / n);
+  printf("\n");
+  exit(0);
+}
@@ -1,110 +1,109 @@
+// find: print the paths of files under a directory with a
+// given name.
+//
+// usage: find [-P procs] path name
+//
+// Directories are read with getdents(), which gives each
+// entry's type along with its name, so the walk needs no
+// stat() per entry. With -P, each subdirectory of path is
+// walked by a child process, procs of them at a time.
+
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "kernel/fs.h"
+#include "kernel/param.h"
 #include "user/user.h"
 
-const char *target;
-
-char* fmtname(char *path) {
-    static char buf[DIRSIZ+1];
-    char *p;
+char *target;
+char path[MAXPATH];
+int procs = 1, nrun;
 
-    // Find first character after last slash.
-    for(p=path+strlen(path); p >= path && *p != '/'; p--)
-        ;
-    p++;
+void walk(int len, int depth);
 
-    // Return blank-padded name.
-    if(strlen(p) >= DIRSIZ)
-        return p;
-    memmove(buf, p, strlen(p));
-    buf[strlen(p)] = '\0';
-    return buf;
-}
+// walk path, a subdirectory of the top, in a child process.
+void
+fork_walk(int len)
+{
+  int pid;
 
-// 1:idr  0:file
-int check(char *path) {
-    struct stat st;
-    if(stat(path, &st) < 0){
-        fprintf(2, "find: cannot stat %s\n", path);
-        return 0; 
-    }
-    char *name;
-    switch(st.type) {
-        case T_FILE:
-            name = fmtname(path);
-            if(strcmp(name, target) == 0) {
-                printf("%s\n", path);
-            }
-            return 0;
-        case T_DIR:
-            name = fmtname(path);
-            if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
-                return 0;
-            }
-            else {
-                return 1;
-            }
-        default:
-            return 0;
-    }
+  while(nrun >= procs){
+    wait(0);
+    nrun--;
+  }
+  if((pid = fork()) < 0){
+    walk(len, 1);
+    return;
+  }
+  if(pid == 0){
+    walk(len, 1);
+    exit(0);
+  }
+  nrun++;
 }
 
-void dfs(char *path) {
-
-    int fd;
-    struct stat st;
-    struct dirent de;    
+// walk the directory path, whose name is len bytes long.
+void
+walk(int len, int depth)
+{
+  struct tdirent de[16];
+  int fd, i, n, m;
 
-    char buf[512], *p;
-
-    if((fd = open(path, 0)) < 0) {
-        fprintf(2, "find: cannot open %s\n", path);
-        return ;
+  if((fd = open(path, 0)) < 0){
+    fprintf(2, "find: cannot open %s\n", path);
+    return;
+  }
+  if(len + 1 + DIRSIZ + 1 > sizeof(path)){
+    fprintf(2, "find: path too long\n");
+    close(fd);
+    return;
+  }
+  path[len] = '/';
+  while((n = getdents(fd, de, sizeof(de))) > 0){
+    for(i = 0; i < n / sizeof(de[0]); i++){
+      if(strcmp(de[i].name, ".") == 0 || strcmp(de[i].name, "..") == 0)
+        continue;
+      memmove(path + len + 1, de[i].name, DIRSIZ);
+      path[len + 1 + DIRSIZ] = 0;
+      m = len + 1 + strlen(path + len + 1);
+      if(de[i].type == T_FILE && strcmp(path + len + 1, target) == 0){
+        printf("%s\n", path);
+      } else if(de[i].type == T_DIR){
+        if(depth == 0 && procs > 1)
+          fork_walk(m);
+        else
+          walk(m, depth + 1);
+      }
     }
+  }
+  path[len] = 0;
+  if(n < 0)
+    fprintf(2, "find: %s is not a directory\n", path);
+  close(fd);
+}
 
-    if(fstat(fd, &st) < 0) {
-        fprintf(2, "find: cannot stat %s\n", path);
-        close(fd);
-        return;
-    }
-    
-    if(st.type != T_DIR) {
-        fprintf(2, "fin: find need DIR, but %s is not.\n", path);
-        close(fd);
-        return ;
-    }
-    
-    if(strlen(path) + 1 + DIRSIZ + 1 > sizeof buf){
-        printf("find: path too long\n");
-        return ;
-    }
+int
+main(int argc, char *argv[])
+{
+  int i;
 
-    strcpy(buf, path);
-    p = buf + strlen(buf);
-    *p++ = '/';
-    while(read(fd, &de, sizeof(de)) == sizeof(de)) {
-        if(de.inum == 0) 
-            continue;
-        memmove(p, de.name, DIRSIZ);
-        p[DIRSIZ] = 0;
-        if(stat(buf, &st) < 0){
-            printf("find: cannot stat %s\n", buf);
-            continue;
-        }
-        if(check(buf)) {
-            dfs(buf);
-        }
-    }
-    close(fd);
+  i = 1;
+  if(argc == 5 && strcmp(argv[1], "-P") == 0){
+    procs = atoi(argv[2]);
+    i = 3;
+  }
+  if(argc - i != 2 || procs <= 0 || strlen(argv[i]) >= sizeof(path)){
+    fprintf(2, "usage: find [-P procs] path name\n");
+    exit(1);
+  }
+  strcpy(path, argv[i]);
+  target = argv[i+1];
+  // children's lines mustn't interleave.
+  if(procs > 1)
+    setvbuf(stdout, _IOLBF);
+  walk(strlen(path), 0);
+  while(nrun > 0){
+    wait(0);
+    nrun--;
+  }
+  exit(0);
 }
-
-int main(int argc, char *argv[]) {
-    if(argc != 3) {
-        fprintf(2, "usage: find <path> <target>\n");
-        exit(1);
-    }
-    target = argv[2];
-    dfs(argv[1]);
-    exit(0);
-}
\ No newline at end of file
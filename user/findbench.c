@@ -0,0 +1,242 @@
+// find benchmark: build a tree of thousands of empty files,
+// then time walking it the old way (read() of raw dirents and
+// a stat() per entry, in-process) and with find -P 1, 2 and 4,
+// counting the system calls each makes.
+//
+// usage: findbench [-f files-per-dir]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/fs.h"
+#include "kernel/param.h"
+#include "kernel/syscall.h"
+#include "kernel/sysstat.h"
+#include "user/user.h"
+
+#define ROOT "fbtree"
+#define NTOP 4      // directories under ROOT
+#define NSUB 8      // directories under each of those
+
+int nfile;
+struct sysstat st[NSYSCALL];
+char path[MAXPATH];
+
+uint64
+now(void)
+{
+  uint64 t;
+
+  clock_gettime(&t);
+  return t;
+}
+
+uint64
+syscalls(void)
+{
+  uint64 n;
+  int i;
+
+  if(sysstat(SS_ALL, 0, st) < 0){
+    fprintf(2, "findbench: sysstat failed\n");
+    exit(1);
+  }
+  n = 0;
+  for(i = 0; i < NSYSCALL; i++)
+    n += st[i].count;
+  return n;
+}
+
+void
+report(char *what, uint64 t, uint64 nsys)
+{
+  int n = NTOP * NSUB * (nfile + 1);
+
+  printf("%s: %l ms, %l entries/s, %l syscalls\n", what, t / 1000000,
+         persec(n, t), nsys);
+}
+
+// append c and the decimal n to path.
+void
+add(char c, int n)
+{
+  char *p = path + strlen(path);
+  char d[12];
+  int i;
+
+  *p++ = '/';
+  *p++ = c;
+  i = 0;
+  do {
+    d[i++] = '0' + n % 10;
+  } while((n /= 10) != 0);
+  while(i > 0)
+    *p++ = d[--i];
+  *p = 0;
+}
+
+// set path to ROOT/di, ROOT/di/sj, or ROOT/di/sj/fk,
+// going as deep as the arguments that aren't -1; the
+// last file in each leaf directory is called needle.
+void
+name(int i, int j, int k)
+{
+  strcpy(path, ROOT);
+  add('d', i);
+  if(j < 0)
+    return;
+  add('s', j);
+  if(k < 0)
+    return;
+  if(k == nfile)
+    strcpy(path + strlen(path), "/needle");
+  else
+    add('f', k);
+}
+
+void
+mk(int dir)
+{
+  int fd;
+
+  if(dir){
+    fd = mkdir(path);
+  } else if((fd = open(path, O_CREATE|O_WRONLY)) >= 0){
+    close(fd);
+  }
+  if(fd < 0){
+    fprintf(2, "findbench: cannot create %s\n", path);
+    exit(1);
+  }
+}
+
+// make the tree, or remove it.
+void
+tree(int make)
+{
+  int i, j, k;
+
+  if(make && mkdir(ROOT) < 0){
+    fprintf(2, "findbench: cannot make %s; left over from before?\n", ROOT);
+    exit(1);
+  }
+  for(i = 0; i < NTOP; i++){
+    name(i, -1, -1);
+    if(make)
+      mk(1);
+    for(j = 0; j < NSUB; j++){
+      name(i, j, -1);
+      if(make)
+        mk(1);
+      for(k = 0; k <= nfile; k++){
+        name(i, j, k);
+        if(make)
+          mk(0);
+        else
+          unlink(path);
+      }
+      name(i, j, -1);
+      if(!make)
+        unlink(path);
+    }
+    name(i, -1, -1);
+    if(!make)
+      unlink(path);
+  }
+  if(!make)
+    unlink(ROOT);
+}
+
+// the old find: read() raw dirents and stat() every entry.
+int
+oldwalk(int len)
+{
+  struct dirent de;
+  struct stat st;
+  int fd, n;
+
+  if((fd = open(path, O_RDONLY)) < 0)
+    return 0;
+  n = 0;
+  path[len] = '/';
+  while(read(fd, &de, sizeof(de)) == sizeof(de)){
+    if(de.inum == 0)
+      continue;
+    memmove(path + len + 1, de.name, DIRSIZ);
+    path[len + 1 + DIRSIZ] = 0;
+    if(stat(path, &st) < 0)
+      continue;
+    if(st.type == T_FILE && strcmp(de.name, "needle") == 0)
+      n++;
+    if(st.type == T_DIR && strcmp(de.name, ".") != 0 && strcmp(de.name, "..") != 0)
+      n += oldwalk(strlen(path));
+  }
+  path[len] = 0;
+  close(fd);
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *args[6];
+  int fdmap[3];
+  uint64 t, n;
+  int i;
+
+  nfile = 64;
+  if(argc == 3 && strcmp(argv[1], "-f") == 0)
+    nfile = atoi(argv[2]);
+  else if(argc != 1)
+    nfile = -1;
+  if(nfile < 0 || NTOP * NSUB * (nfile + 1) + NTOP * NSUB + NTOP + 1 > 2500){
+    fprintf(2, "usage: findbench [-f files-per-dir]\n");
+    exit(1);
+  }
+
+  printf("findbench: %d files in %d directories\n", NTOP * NSUB * (nfile + 1), NTOP * NSUB + NTOP + 1);
+  n = syscalls();
+  t = now();
+  tree(1);
+  t = now() - t;
+  report("create", t, syscalls() - n);
+
+  n = syscalls();
+  t = now();
+  strcpy(path, ROOT);
+  if(oldwalk(strlen(path)) != NTOP * NSUB){
+    fprintf(2, "findbench: old walk found the wrong files\n");
+    exit(1);
+  }
+  t = now() - t;
+  report("read+stat walk", t, syscalls() - n);
+
+  // find's output goes nowhere.
+  fdmap[0] = 0;
+  fdmap[1] = -1;
+  fdmap[2] = 2;
+  for(i = 1; i <= 4; i *= 2){
+    args[0] = "find";
+    args[1] = "-P";
+    args[2] = i == 1 ? "1" : i == 2 ? "2" : "4";
+    args[3] = ROOT;
+    args[4] = "needle";
+    args[5] = 0;
+    n = syscalls();
+    t = now();
+    if(spawn("find", args, fdmap) < 0){
+      fprintf(2, "findbench: cannot run find\n");
+      exit(1);
+    }
+    wait(0);
+    t = now() - t;
+    report(i == 1 ? "find -P 1" : i == 2 ? "find -P 2" : "find -P 4", t, syscalls() - n);
+  }
+
+  n = syscalls();
+  t = now();
+  tree(0);
+  t = now() - t;
+  report("remove", t, syscalls() - n);
+  exit(0);
+}
@@ -0,0 +1,127 @@
+// Lock contention benchmark: nthreads threads each bump a
+// shared counter iters times, under a spinning lock and then
+// under a futex mutex; then two threads ping-pong through a
+// condition variable.
+//
+// usage: futexbench [-t nthreads] [-n iters]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define USPERTICK 100000  // timerinit(): 1000000 cycles at 10MHz
+#define MAXT 16
+
+int nthread, iters;
+volatile int counter;
+
+volatile int spin;
+struct mutex mu;
+
+void
+spinworker(void *arg)
+{
+  for(int i = 0; i < iters; i++){
+    while(__sync_lock_test_and_set(&spin, 1) != 0)
+      ;
+    counter++;
+    __sync_lock_release(&spin);
+  }
+}
+
+void
+mutexworker(void *arg)
+{
+  for(int i = 0; i < iters; i++){
+    mutex_lock(&mu);
+    counter++;
+    mutex_unlock(&mu);
+  }
+}
+
+int
+run(char *what, void (*fn)(void*))
+{
+  int i, t0, t, tid[MAXT];
+
+  counter = 0;
+  t0 = uptime();
+  for(i = 0; i < nthread; i++){
+    if((tid[i] = thread_create(fn, 0)) < 0){
+      fprintf(2, "futexbench: thread_create failed\n");
+      exit(1);
+    }
+  }
+  for(i = 0; i < nthread; i++)
+    thread_join(tid[i]);
+  t = uptime() - t0;
+
+  if(counter != nthread * iters){
+    fprintf(2, "futexbench: %s: counter %d, want %d\n", what, counter, nthread * iters);
+    exit(1);
+  }
+  printf("%s: %d ticks", what, t);
+  if(t > 0)
+    printf(", %d ns/op", (int)((uint64)t * USPERTICK * 1000 / (nthread * iters)));
+  printf("\n");
+  return t;
+}
+
+struct cond cv;
+volatile int turn;
+
+void
+pingpong(void *arg)
+{
+  int me = (int)(uint64)arg;
+
+  mutex_lock(&mu);
+  for(int i = 0; i < iters; i++){
+    while(turn != me)
+      cond_wait(&cv, &mu);
+    turn = !me;
+    cond_broadcast(&cv);
+  }
+  mutex_unlock(&mu);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, t0, t, tid[2];
+
+  nthread = 4;
+  iters = 10000;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-t") == 0)
+      nthread = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-n") == 0)
+      iters = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i < argc || nthread <= 0 || nthread > MAXT || iters < 100){
+    fprintf(2, "usage: futexbench [-t nthreads] [-n iters]\n");
+    exit(1);
+  }
+
+  printf("futexbench: %d threads x %d iters\n", nthread, iters);
+  run("spinlock", spinworker);
+  mutex_init(&mu);
+  run("mutex", mutexworker);
+
+  cond_init(&cv);
+  turn = 0;
+  t0 = uptime();
+  for(i = 0; i < 2; i++){
+    if((tid[i] = thread_create(pingpong, (void*)(uint64)i)) < 0){
+      fprintf(2, "futexbench: thread_create failed\n");
+      exit(1);
+    }
+  }
+  for(i = 0; i < 2; i++)
+    thread_join(tid[i]);
+  t = uptime() - t0;
+  printf("condvar ping-pong: %d round trips in %d ticks\n", iters, t);
+  exit(0);
+}
@@ -1,52 +1,308 @@
-// Simple grep.  Only supports ^ . * $ operators.
+// grep: print lines matching a regular expression.
+//
+// Understands c, ., [class], [^class], \c, each optionally
+// followed by *, + or ?, and ^ and $ at the ends of the pattern.
+//
+// Without alternation or groups a pattern is a string of atoms,
+// and the set of atoms a match can have reached fits in a
+// uint64. The matcher runs those sets as the states of a DFA,
+// built lazily one transition at a time and cached, so each
+// byte of input costs one table lookup. A pattern that starts
+// with a literal string doesn't look at most lines at all:
+// memchr() skips to the string's first byte.
 
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "user/user.h"
 
-char buf[1024];
-int match(char*, char*);
+#define READSZ 4096
+#define NATOM 62          // atom NATOM is the match state
+#define NDSTATE 128
+
+char buf[2*READSZ];
+
+struct {
+  int n;                  // atoms
+  uint64 set[NATOM][4];   // bytes each atom matches
+  char quant[NATOM];      // 0, '*' or '?'
+  int bol, eol;           // anchored by ^, $
+  char lit[NATOM];        // literal prefix
+  int nlit;
+} re;
+
+struct dstate {
+  uint64 nfa;             // atoms reached
+  short next[256];        // states after each byte; -1 if not built yet
+};
+
+struct dstate dfa[NDSTATE];
+int ndfa;
+
+void
+fatal(char *msg)
+{
+  fprintf(2, "grep: %s\n", msg);
+  exit(1);
+}
+
+void
+addbyte(int i, int c)
+{
+  c &= 0xff;
+  re.set[i][c / 64] |= 1L << (c % 64);
+}
+
+int
+inset(int i, int c)
+{
+  return (re.set[i][c / 64] >> (c % 64)) & 1;
+}
+
+// parse a [class] starting after its [, into atom i.
+// returns the pattern after the ].
+char*
+parseclass(char *p, int i)
+{
+  int neg, c, j;
+
+  neg = *p == '^';
+  if(neg)
+    p++;
+  // a ] first is part of the class.
+  for(c = 1; *p && (*p != ']' || c); p++, c = 0){
+    if(p[1] == '-' && p[2] && p[2] != ']'){
+      for(j = (uchar)p[0]; j <= (uchar)p[2]; j++)
+        addbyte(i, j);
+      p += 2;
+    } else {
+      addbyte(i, *p);
+    }
+  }
+  if(*p != ']')
+    fatal("unterminated [");
+  if(neg)
+    for(j = 0; j < 4; j++)
+      re.set[i][j] = ~re.set[i][j];
+  return p + 1;
+}
+
+void
+compile(char *p)
+{
+  int i, c, lit;
+
+  if(*p == '^'){
+    re.bol = 1;
+    p++;
+  }
+  while(*p){
+    if(p[0] == '$' && p[1] == 0){
+      re.eol = 1;
+      break;
+    }
+    if(re.n >= NATOM - 1)
+      fatal("pattern too long");
+    i = re.n++;
+    lit = -1;
+    if(*p == '.'){
+      for(c = 0; c < 4; c++)
+        re.set[i][c] = ~0L;
+      p++;
+    } else if(*p == '['){
+      p = parseclass(p + 1, i);
+    } else {
+      if(*p == '\\' && p[1])
+        p++;
+      lit = (uchar)*p++;
+      addbyte(i, lit);
+    }
+    if(*p == '*' || *p == '?'){
+      re.quant[i] = *p++;
+    } else if(*p == '+'){
+      // x+ is xx*
+      memmove(re.set[re.n], re.set[i], sizeof(re.set[i]));
+      re.quant[re.n++] = '*';
+      p++;
+    }
+    if(lit >= 0 && re.quant[i] == 0 && re.nlit == i)
+      re.lit[re.nlit++] = lit;
+  }
+  if(re.bol)
+    re.nlit = 0;
+}
+
+// add the atoms reachable from s without consuming input.
+uint64
+closure(uint64 s)
+{
+  int i;
+
+  for(i = 0; i < re.n; i++)
+    if(((s >> i) & 1) && re.quant[i])
+      s |= 1L << (i + 1);
+  return s;
+}
+
+// the DFA state for nfa, made if need be. When the cache is
+// full, throw it all away; state 0 is always the start.
+int
+dstate(uint64 nfa)
+{
+  int i;
+
+  for(i = 0; i < ndfa; i++)
+    if(dfa[i].nfa == nfa)
+      return i;
+  if(ndfa == NDSTATE){
+    ndfa = 0;
+    dstate(closure(1));
+  }
+  i = ndfa++;
+  dfa[i].nfa = nfa;
+  memset(dfa[i].next, 0xff, sizeof(dfa[i].next));
+  return i;
+}
+
+int
+step(int d, int c)
+{
+  uint64 s, t;
+  int i, n, gen;
+
+  s = dfa[d].nfa;
+  t = 0;
+  for(i = 0; i < re.n; i++)
+    if(((s >> i) & 1) && inset(i, c))
+      t |= 1L << (re.quant[i] == '*' ? i : i + 1);
+  t = closure(t);
+  if(!re.bol)
+    t |= dfa[0].nfa;   // a match can start anywhere
+  gen = ndfa;
+  n = dstate(t);
+  if(ndfa >= gen)  // d wasn't thrown away
+    dfa[d].next[c] = n;
+  return n;
+}
+
+int
+accepting(int d)
+{
+  return (dfa[d].nfa >> re.n) & 1;
+}
+
+// does the line [p, e) match?
+int
+matchline(char *p, char *e)
+{
+  int d, n;
+
+  d = 0;
+  for(; p < e; p++){
+    if(accepting(d) && !re.eol)
+      return 1;
+    if(dfa[d].nfa == 0)
+      return 0;
+    if((n = dfa[d].next[(uchar)*p]) < 0)
+      n = step(d, (uchar)*p);
+    d = n;
+  }
+  return accepting(d);
+}
+
+// print the line [p, e), which ends in a newline if e < end.
+void
+output(char *p, char *e, char *end)
+{
+  if(e < end)
+    fwrite(p, 1, e + 1 - p, stdout);
+  else {
+    fwrite(p, 1, e - p, stdout);
+    fputc('\n', stdout);
+  }
+}
+
+// print the matching lines among [p, end); every line
+// but perhaps the last ends with a newline.
+void
+scan(char *p, char *end)
+{
+  char *h, *e, *line, *seen;
+
+  if(re.nlit == 0){
+    for(; p < end; p = e + 1){
+      if((e = memchr(p, '\n', end - p)) == 0)
+        e = end;
+      if(matchline(p, e))
+        output(p, e, end);
+    }
+    return;
+  }
+
+  // a matching line holds the literal prefix. line is the
+  // start of the line holding seen; we skip forward.
+  line = seen = p;
+  while((h = memchr(p, re.lit[0], end - p)) != 0){
+    if(end - h < re.nlit || memcmp(h, re.lit, re.nlit) != 0){
+      p = h + 1;
+      continue;
+    }
+    for(e = h; e > seen; e--)
+      if(e[-1] == '\n'){
+        line = e;
+        break;
+      }
+    if((e = memchr(h, '\n', end - h)) == 0)
+      e = end;
+    if(matchline(line, e))
+      output(line, e, end);
+    p = line = seen = e + 1;
+    if(p >= end)
+      break;
+  }
+}
 
 void
-grep(char *pattern, int fd)
+grep(int fd)
 {
   int n, m;
-  char *p, *q;
+  char *e;
 
   m = 0;
-  while((n = read(fd, buf+m, sizeof(buf)-m-1)) > 0){
+  for(;;){
+    n = sizeof(buf) - m;
+    if(n > READSZ)
+      n = READSZ;
+    if((n = read(fd, buf + m, n)) <= 0)
+      break;
     m += n;
-    buf[m] = '\0';
-    p = buf;
-    while((q = strchr(p, '\n')) != 0){
-      *q = 0;
-      if(match(pattern, p)){
-        *q = '\n';
-        write(1, p, q+1 - p);
-      }
-      p = q+1;
-    }
-    if(m > 0){
-      m -= p - buf;
-      memmove(buf, p, m);
-    }
+    // pass on the complete lines, or the whole
+    // buffer if one line fills it.
+    for(e = buf + m; e > buf && e[-1] != '\n'; e--)
+      ;
+    if(e == buf && m == sizeof(buf))
+      e = buf + m;
+    scan(buf, e);
+    m -= e - buf;
+    memmove(buf, e, m);
   }
+  if(m > 0)
+    scan(buf, buf + m);
 }
 
 int
 main(int argc, char *argv[])
 {
   int fd, i;
-  char *pattern;
 
   if(argc <= 1){
     fprintf(2, "usage: grep pattern [file ...]\n");
     exit(1);
   }
-  pattern = argv[1];
+  compile(argv[1]);
+  dstate(closure(1));
 
   if(argc <= 2){
-    grep(pattern, 0);
+    grep(0);
     exit(0);
   }
 
@@ -55,51 +311,8 @@ main(int argc, char *argv[])
       printf("grep: cannot open %s\n", argv[i]);
       exit(1);
     }
-    grep(pattern, fd);
+    grep(fd);
     close(fd);
   }
   exit(0);
 }
-
-// Regexp matcher from Kernighan & Pike,
-// The Practice of Programming, Chapter 9.
-
-int matchhere(char*, char*);
-int matchstar(int, char*, char*);
-
-int
-match(char *re, char *text)
-{
-  if(re[0] == '^')
-    return matchhere(re+1, text);
-  do{  // must look at empty string
-    if(matchhere(re, text))
-      return 1;
-  }while(*text++ != '\0');
-  return 0;
-}
-
-// matchhere: search for re at beginning of text
-int matchhere(char *re, char *text)
-{
-  if(re[0] == '\0')
-    return 1;
-  if(re[1] == '*')
-    return matchstar(re[0], re+2, text);
-  if(re[0] == '$' && re[1] == '\0')
-    return *text == '\0';
-  if(*text!='\0' && (re[0]=='.' || re[0]==*text))
-    return matchhere(re+1, text+1);
-  return 0;
-}
-
-// matchstar: search for c*re at beginning of text
-int matchstar(int c, char *re, char *text)
-{
-  do{  // a * matches zero or more instances
-    if(matchhere(re, text))
-      return 1;
-  }while(*text!='\0' && (*text++==c || c=='.'));
-  return 0;
-}
-
@@ -0,0 +1,198 @@
+// grep throughput: generate a corpus of random words, then
+// time grep over it with a few kinds of pattern, next to the
+// backtracking matcher grep used to have (1KB reads, and
+// only ^ . * $), run here in-process.
+//
+// usage: grepbench [-k kbytes]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define CORPUS "grepbench.txt"
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+char *words[] = {
+  "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+  "kernel", "page", "table", "trap", "frame", "lock", "sleep", "wakeup",
+  "inode", "buffer", "disk", "pipe", "file", "zombie", "hart", "timer",
+};
+
+struct {
+  char *re;
+  int old;     // the old matcher understands it
+} patterns[] = {
+  { "hello", 1 },
+  { "zombie", 1 },
+  { "^the.*dog", 1 },
+  { "e.*z$", 1 },
+  { "[0-9][0-9]+x", 0 },
+  { "[a-f]+ [^ ]*ee", 0 },
+};
+
+uint seed = 1;
+
+int
+rnd(int n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) % n;
+}
+
+void
+corpus(int kb)
+{
+  FILE *f;
+  int fd, n, len;
+
+  if((fd = open(CORPUS, O_CREATE|O_TRUNC|O_WRONLY)) < 0 || (f = fdopen(fd, "w")) == 0){
+    fprintf(2, "grepbench: cannot create %s\n", CORPUS);
+    exit(1);
+  }
+  for(n = 0; n < kb * 1024; ){
+    len = 0;
+    while(len < 40 + rnd(40)){
+      if(rnd(8) == 0)
+        fileprintf(f, "%d ", rnd(1000));
+      else
+        fileprintf(f, "%s ", words[rnd(NELEM(words))]);
+      len += 6;
+    }
+    fputs(rnd(4) ? "\n" : "xyz\n", f);
+    n += len;
+  }
+  fclose(f);
+}
+
+// the old grep's matcher, from Kernighan & Pike,
+// The Practice of Programming, Chapter 9.
+
+int matchhere(char*, char*);
+
+int
+matchstar(int c, char *re, char *text)
+{
+  do{
+    if(matchhere(re, text))
+      return 1;
+  }while(*text!='\0' && (*text++==c || c=='.'));
+  return 0;
+}
+
+int
+matchhere(char *re, char *text)
+{
+  if(re[0] == '\0')
+    return 1;
+  if(re[1] == '*')
+    return matchstar(re[0], re+2, text);
+  if(re[0] == '$' && re[1] == '\0')
+    return *text == '\0';
+  if(*text!='\0' && (re[0]=='.' || re[0]==*text))
+    return matchhere(re+1, text+1);
+  return 0;
+}
+
+int
+match(char *re, char *text)
+{
+  if(re[0] == '^')
+    return matchhere(re+1, text);
+  do{
+    if(matchhere(re, text))
+      return 1;
+  }while(*text++ != '\0');
+  return 0;
+}
+
+// the old grep's loop, counting matches instead of printing them.
+int
+oldgrep(char *pattern, int fd)
+{
+  static char buf[1024];
+  int n, m, hits;
+  char *p, *q;
+
+  m = hits = 0;
+  while((n = read(fd, buf+m, sizeof(buf)-m-1)) > 0){
+    m += n;
+    buf[m] = '\0';
+    p = buf;
+    while((q = strchr(p, '\n')) != 0){
+      *q = 0;
+      hits += match(pattern, p);
+      p = q+1;
+    }
+    if(m > 0){
+      m -= p - buf;
+      memmove(buf, p, m);
+    }
+  }
+  return hits;
+}
+
+uint64
+now(void)
+{
+  uint64 t;
+
+  clock_gettime(&t);
+  return t;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *argv1[4];
+  int fdmap[3];
+  int i, kb, fd;
+  uint64 t;
+
+  kb = 256;
+  if(argc == 3 && strcmp(argv[1], "-k") == 0)
+    kb = atoi(argv[2]);
+  else if(argc != 1)
+    kb = 0;
+  if(kb <= 0){
+    fprintf(2, "usage: grepbench [-k kbytes]\n");
+    exit(1);
+  }
+
+  corpus(kb);
+  printf("grepbench: %d KB corpus, KB/s\n", kb);
+
+  // grep's output goes nowhere.
+  fdmap[0] = 0;
+  fdmap[1] = -1;
+  fdmap[2] = 2;
+  for(i = 0; i < NELEM(patterns); i++){
+    argv1[0] = "grep";
+    argv1[1] = patterns[i].re;
+    argv1[2] = CORPUS;
+    argv1[3] = 0;
+    t = now();
+    if(spawn("grep", argv1, fdmap) < 0){
+      fprintf(2, "grepbench: cannot run grep\n");
+      exit(1);
+    }
+    wait(0);
+    t = now() - t;
+    printf("%s: grep %l", patterns[i].re, persec(kb, t));
+
+    if(patterns[i].old){
+      if((fd = open(CORPUS, O_RDONLY)) < 0){
+        fprintf(2, "grepbench: cannot open %s\n", CORPUS);
+        exit(1);
+      }
+      t = now();
+      oldgrep(patterns[i].re, fd);
+      t = now() - t;
+      close(fd);
+      printf(", backtracking %l", persec(kb, t));
+    }
+    printf("\n");
+  }
+  unlink(CORPUS);
+  exit(0);
+}
@@ -0,0 +1,91 @@
+// Inode lock contention benchmark: nproc processes each
+// fstat() one shared file iters times, so that each call is
+// an ilock()/iunlock() of the same inode; then each stat()s
+// the file by name, which also locks every directory on the
+// path. Reports the wall time per operation.
+//
+// usage: ilockbench [-p nproc] [-n iters]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define MAXP 16
+#define TMPFILE "ilockbench.tmp"
+
+int nproc, iters;
+
+void
+run(char *what, int byname)
+{
+  int i, j, fd;
+  uint64 t0, t1;
+  struct stat st;
+
+  if((fd = open(TMPFILE, O_RDONLY)) < 0){
+    fprintf(2, "ilockbench: cannot open %s\n", TMPFILE);
+    exit(1);
+  }
+  clock_gettime(&t0);
+  for(i = 0; i < nproc; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "ilockbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      for(j = 0; j < iters; j++){
+        if((byname ? stat(TMPFILE, &st) : fstat(fd, &st)) < 0){
+          fprintf(2, "ilockbench: %s failed\n", what);
+          exit(1);
+        }
+      }
+      exit(0);
+    }
+  }
+  for(i = 0; i < nproc; i++){
+    int xstatus;
+    wait(&xstatus);
+    if(xstatus != 0)
+      exit(1);
+  }
+  clock_gettime(&t1);
+  close(fd);
+
+  printf("%s: %d ms, %d ns/op\n", what, (int)((t1 - t0) / 1000000),
+         (int)((t1 - t0) / ((uint64)nproc * iters)));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, fd;
+
+  nproc = 4;
+  iters = 5000;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-p") == 0)
+      nproc = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-n") == 0)
+      iters = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i < argc || nproc <= 0 || nproc > MAXP || iters <= 0){
+    fprintf(2, "usage: ilockbench [-p nproc] [-n iters]\n");
+    exit(1);
+  }
+
+  if((fd = open(TMPFILE, O_CREATE|O_WRONLY)) < 0){
+    fprintf(2, "ilockbench: cannot create %s\n", TMPFILE);
+    exit(1);
+  }
+  close(fd);
+
+  printf("ilockbench: %d procs x %d iters\n", nproc, iters);
+  run("fstat", 0);
+  run("stat", 1);
+  unlink(TMPFILE);
+  exit(0);
+}
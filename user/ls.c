@@ -25,9 +25,9 @@ fmtname(char *path)
 void
 ls(char *path)
 {
-  char buf[512], *p;
-  int fd;
-  struct dirent de;
+  char name[DIRSIZ+1];
+  int fd, i, n;
+  struct direntplus de[16];
   struct stat st;
 
   if((fd = open(path, 0)) < 0){
@@ -47,24 +47,17 @@ ls(char *path)
     break;
 
   case T_DIR:
-    if(strlen(path) + 1 + DIRSIZ + 1 > sizeof buf){
-      printf("ls: path too long\n");
-      break;
-    }
-    strcpy(buf, path);
-    p = buf+strlen(buf);
-    *p++ = '/';
-    while(read(fd, &de, sizeof(de)) == sizeof(de)){
-      if(de.inum == 0)
-        continue;
-      memmove(p, de.name, DIRSIZ);
-      p[DIRSIZ] = 0;
-      if(stat(buf, &st) < 0){
-        printf("ls: cannot stat %s\n", buf);
-        continue;
+    // readdirplus() gives each entry's type and size too,
+    // so there is no stat() per name.
+    while((n = readdirplus(fd, de, sizeof(de))) > 0){
+      for(i = 0; i < n / sizeof(de[0]); i++){
+        memmove(name, de[i].name, DIRSIZ);
+        name[DIRSIZ] = 0;
+        printf("%s %d %d %d\n", fmtname(name), de[i].type, de[i].inum, de[i].size);
       }
-      printf("%s %d %d %d\n", fmtname(buf), st.type, st.ino, st.size);
     }
+    if(n < 0)
+      printf("ls: cannot read %s\n", path);
     break;
   }
   close(fd);
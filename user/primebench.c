@@ -0,0 +1,228 @@
+// prime sieve benchmark: the primes pipeline, with knobs.
+// A generator writes 2..n into a chain of depth processes
+// joined by pipes, batch numbers to a write(). Each stage
+// keeps the first number it reads, which is prime, and passes
+// on those it doesn't divide; the last stage finds the primes
+// among what reaches it by trial division. Reports numbers
+// per second, and checks the count of primes.
+//
+// usage: primebench [-n n] [-b batch] [-d depth] [-p pipesize]
+//
+// Without -p, runs with pipe() and with a 64KB pipe2().
+
+#include "kernel/types.h"
+#include "user/user.h"
+
+#define MAXN 50000000
+#define MAXBATCH 1024
+#define MAXDEPTH 32
+#define NSMALL 4800       // primes below sqrt(2^31)
+
+int n, batch, depth, psize;
+int ib[MAXBATCH], ob[MAXBATCH];
+int small[NSMALL];
+
+void
+fatal(char *msg)
+{
+  fprintf(2, "primebench: %s\n", msg);
+  exit(-1);
+}
+
+void
+mkpipe(int *p)
+{
+  if((psize ? pipe2(p, psize) : pipe(p)) < 0)
+    fatal("pipe failed");
+}
+
+// read up to batch numbers into b. returns how many,
+// 0 at the end.
+int
+readn(int fd, int *b)
+{
+  int m, r;
+
+  for(m = 0; m < batch * 4; m += r)
+    if((r = read(fd, (char*)b + m, batch * 4 - m)) <= 0)
+      break;
+  return m / 4;
+}
+
+void
+writen(int fd, int *b, int m)
+{
+  if(write(fd, b, m * 4) != m * 4)
+    fatal("write failed");
+}
+
+// the last stage: what arrives is in order and has no factor
+// among the earlier stages' primes, so it is prime unless
+// a prime found here divides it. Exits with the count.
+void
+last(int in, int m)
+{
+  int i, j, x, np, found, composite;
+
+  np = found = 0;
+  do {
+    for(i = 0; i < m; i++){
+      x = ib[i];
+      composite = 0;
+      for(j = 0; j < np && small[j] <= x / small[j] && !composite; j++)
+        composite = x % small[j] == 0;
+      if(composite)
+        continue;
+      found++;
+      if(x <= n / x && np < NSMALL)
+        small[np++] = x;
+    }
+  } while((m = readn(in, ib)) > 0);
+  exit(found);
+}
+
+// stage d of the chain, reading from in. Exits with the
+// number of primes found by it and the stages after it.
+void
+stage(int in, int d)
+{
+  int p[2], pid, prime, i, m, no, status;
+
+  if((m = readn(in, ib)) == 0)
+    exit(0);
+  if(d == depth - 1)
+    last(in, m);
+  prime = ib[0];
+  mkpipe(p);
+  if((pid = fork()) < 0)
+    fatal("fork failed");
+  if(pid == 0){
+    close(in);
+    close(p[1]);
+    stage(p[0], d + 1);
+  }
+  close(p[0]);
+  no = 0;
+  i = 1;
+  do {
+    for(; i < m; i++){
+      if(ib[i] % prime == 0)
+        continue;
+      ob[no++] = ib[i];
+      if(no == batch){
+        writen(p[1], ob, no);
+        no = 0;
+      }
+    }
+    i = 0;
+  } while((m = readn(in, ib)) > 0);
+  if(no > 0)
+    writen(p[1], ob, no);
+  close(p[1]);
+  close(in);
+  wait(&status);
+  exit(status < 0 ? status : status + 1);
+}
+
+// primes up to n, the slow sure way.
+int
+sieve(void)
+{
+  uchar *bits;
+  int i, j, c;
+
+  if((bits = malloc(n / 8 + 1)) == 0)
+    fatal("out of memory");
+  memset(bits, 0, n / 8 + 1);
+  c = 0;
+  for(i = 2; i <= n; i++){
+    if(bits[i / 8] & (1 << (i % 8)))
+      continue;
+    c++;
+    if(i <= n / i)
+      for(j = i * i; j <= n; j += i)
+        bits[j / 8] |= 1 << (j % 8);
+  }
+  free(bits);
+  return c;
+}
+
+// run the sieve once; returns the count of primes.
+int
+run(void)
+{
+  int p[2], pid, i, m, status;
+  uint64 t0, t1;
+
+  clock_gettime(&t0);
+  mkpipe(p);
+  if((pid = fork()) < 0)
+    fatal("fork failed");
+  if(pid == 0){
+    close(p[1]);
+    stage(p[0], 0);
+  }
+  close(p[0]);
+  m = 0;
+  for(i = 2; i <= n; i++){
+    ob[m++] = i;
+    if(m == batch){
+      writen(p[1], ob, m);
+      m = 0;
+    }
+  }
+  if(m > 0)
+    writen(p[1], ob, m);
+  close(p[1]);
+  wait(&status);
+  clock_gettime(&t1);
+  printf("n %d batch %d depth %d pipe %d: %l ms, %l numbers/s, %d primes\n",
+         n, batch, depth, psize ? psize : 512, (t1 - t0) / 1000000,
+         persec(n - 1, t1 - t0), status);
+  return status;
+}
+
+void
+usage(void)
+{
+  fprintf(2, "usage: primebench [-n n] [-b batch] [-d depth] [-p pipesize]\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, c, r, p;
+
+  n = 200000;
+  batch = 64;
+  depth = 16;
+  p = -1;
+  for(i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2){
+    if(strcmp(argv[i], "-n") == 0)
+      n = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-b") == 0)
+      batch = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-d") == 0)
+      depth = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-p") == 0)
+      p = atoi(argv[i+1]);
+    else
+      usage();
+  }
+  if(i != argc || n < 2 || n > MAXN || batch < 1 || batch > MAXBATCH ||
+     depth < 1 || depth > MAXDEPTH)
+    usage();
+
+  c = sieve();
+  for(i = 0; i < 2; i++){
+    if(p >= 0 && i > 0)
+      break;
+    psize = p >= 0 ? p : i * 65536;
+    if((r = run()) != c){
+      fprintf(2, "primebench: found %d primes, not %d\n", r, c);
+      exit(1);
+    }
+  }
+  exit(0);
+}
@@ -7,25 +7,10 @@
 static char digits[] = "0123456789ABCDEF";
 
 static void
-putc(int fd, char c)
+printint(FILE *f, uint64 x, int base, int neg)
 {
-  write(fd, &c, 1);
-}
-
-static void
-printint(int fd, int xx, int base, int sgn)
-{
-  char buf[16];
-  int i, neg;
-  uint x;
-
-  neg = 0;
-  if(sgn && xx < 0){
-    neg = 1;
-    x = -xx;
-  } else {
-    x = xx;
-  }
+  char buf[24];
+  int i;
 
   i = 0;
   do{
@@ -35,24 +20,25 @@ printint(int fd, int xx, int base, int sgn)
     buf[i++] = '-';
 
   while(--i >= 0)
-    putc(fd, buf[i]);
+    putch(f, buf[i]);
 }
 
 static void
-printptr(int fd, uint64 x) {
+printptr(FILE *f, uint64 x) {
   int i;
-  putc(fd, '0');
-  putc(fd, 'x');
+  putch(f, '0');
+  putch(f, 'x');
   for (i = 0; i < (sizeof(uint64) * 2); i++, x <<= 4)
-    putc(fd, digits[x >> (sizeof(uint64) * 8 - 4)]);
+    putch(f, digits[x >> (sizeof(uint64) * 8 - 4)]);
 }
 
-// Print to the given fd. Only understands %d, %x, %p, %s.
-void
-vprintf(int fd, const char *fmt, va_list ap)
+// Print to the given stream. Only understands %d, %l, %x, %p, %s, %c.
+// The caller holds f's lock.
+static void
+vprintf(FILE *f, const char *fmt, va_list ap)
 {
   char *s;
-  int c, i, state;
+  int c, d, i, state;
 
   state = 0;
   for(i = 0; fmt[i]; i++){
@@ -61,46 +47,75 @@ vprintf(int fd, const char *fmt, va_list ap)
       if(c == '%'){
         state = '%';
       } else {
-        putc(fd, c);
+        putch(f, c);
       }
     } else if(state == '%'){
       if(c == 'd'){
-        printint(fd, va_arg(ap, int), 10, 1);
+        d = va_arg(ap, int);
+        printint(f, d < 0 ? -(uint64)d : d, 10, d < 0);
       } else if(c == 'l') {
-        printint(fd, va_arg(ap, uint64), 10, 0);
+        printint(f, va_arg(ap, uint64), 10, 0);
       } else if(c == 'x') {
-        printint(fd, va_arg(ap, int), 16, 0);
+        printint(f, va_arg(ap, uint), 16, 0);
       } else if(c == 'p') {
-        printptr(fd, va_arg(ap, uint64));
+        printptr(f, va_arg(ap, uint64));
       } else if(c == 's'){
         s = va_arg(ap, char*);
         if(s == 0)
           s = "(null)";
         while(*s != 0){
-          putc(fd, *s);
+          putch(f, *s);
           s++;
         }
       } else if(c == 'c'){
-        putc(fd, va_arg(ap, uint));
+        putch(f, va_arg(ap, uint));
       } else if(c == '%'){
-        putc(fd, c);
+        putch(f, c);
       } else {
         // Unknown % sequence.  Print it to draw attention.
-        putc(fd, '%');
-        putc(fd, c);
+        putch(f, '%');
+        putch(f, c);
       }
       state = 0;
     }
   }
 }
 
+static void
+fvprintf(FILE *f, const char *fmt, va_list ap)
+{
+  flock(f);
+  vprintf(f, fmt, ap);
+  fendcall(f);
+  funlock(f);
+}
+
+void
+fileprintf(FILE *f, const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  fvprintf(f, fmt, ap);
+}
+
+// fds 1 and 2 go through stdout and stderr; any other
+// gets a stream of its own for the one call.
 void
 fprintf(int fd, const char *fmt, ...)
 {
   va_list ap;
+  FILE tmp;
 
   va_start(ap, fmt);
-  vprintf(fd, fmt, ap);
+  if(fd == 1)
+    fvprintf(stdout, fmt, ap);
+  else if(fd == 2)
+    fvprintf(stderr, fmt, ap);
+  else {
+    finit(&tmp, fd, _IONBF);
+    fvprintf(&tmp, fmt, ap);
+  }
 }
 
 void
@@ -109,5 +124,5 @@ printf(const char *fmt, ...)
   va_list ap;
 
   va_start(ap, fmt);
-  vprintf(1, fmt, ap);
+  fvprintf(stdout, fmt, ap);
 }
@@ -0,0 +1,279 @@
+// Sampling profiler: run a command with the kernel's profiler
+// on, then print a flat profile of the samples, symbolized
+// with kernel.sym and the command's <prog>.sym. "self" is the
+// share of samples taken in a function; "total" also counts
+// kernel samples with the function further up the backtrace.
+//
+// usage: prof [-r hz] [-n top] command [args...]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/param.h"
+#include "kernel/prof.h"
+#include "user/user.h"
+
+#define CHUNK 64
+
+struct sym {
+  uint64 addr;
+  char *name;
+  int user;
+  int self, total;
+  int stamp;          // last sample counted in total
+};
+
+struct symtab {
+  struct sym *s;
+  int n;
+};
+
+struct symtab ktab, utab;
+struct profsample *samples;
+int nsample;
+
+int
+ishex(int c)
+{
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+}
+
+// load a symbol table made by objdump -t and sed: "addr name"
+// lines. leave out file names and local labels.
+void
+loadsyms(struct symtab *t, char *file, int user)
+{
+  struct stat st;
+  char *buf, *p, *q, *name;
+  int fd, n, len;
+  uint64 addr;
+
+  if((fd = open(file, O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+    fprintf(2, "prof: no symbols in %s\n", file);
+    return;
+  }
+  if((buf = malloc(st.size + 1)) == 0 || read(fd, buf, st.size) != st.size){
+    fprintf(2, "prof: can't read %s\n", file);
+    exit(1);
+  }
+  close(fd);
+  buf[st.size] = 0;
+
+  n = 0;
+  for(p = buf; *p; p++)
+    if(*p == '\n')
+      n++;
+  if((t->s = malloc((n + 1) * sizeof(struct sym))) == 0){
+    fprintf(2, "prof: out of memory\n");
+    exit(1);
+  }
+
+  for(p = buf; *p; p = q){
+    for(q = p; *q && *q != '\n'; q++)
+      ;
+    if(*q)
+      *q++ = 0;
+    for(addr = 0; ishex(*p); p++)
+      addr = addr * 16 + (*p <= '9' ? *p - '0' : *p - 'a' + 10);
+    if(*p++ != ' ')
+      continue;
+    name = p;
+    len = strlen(name);
+    if(len == 0 || name[0] == '.' || name[0] == '$')
+      continue;
+    if(len > 2 && name[len-2] == '.' && (name[len-1] == 'c' || name[len-1] == 'S'))
+      continue;
+    t->s[t->n].addr = addr;
+    t->s[t->n].name = name;
+    t->s[t->n].user = user;
+    t->s[t->n].self = t->s[t->n].total = 0;
+    t->s[t->n].stamp = -1;
+    t->n++;
+  }
+
+  // shell sort by address.
+  for(int gap = t->n / 2; gap > 0; gap /= 2){
+    for(int i = gap; i < t->n; i++){
+      struct sym s = t->s[i];
+      int j;
+      for(j = i; j >= gap && t->s[j-gap].addr > s.addr; j -= gap)
+        t->s[j] = t->s[j-gap];
+      t->s[j] = s;
+    }
+  }
+}
+
+// the symbol with the greatest address <= pc.
+struct sym*
+lookup(struct symtab *t, uint64 pc)
+{
+  int lo = 0, hi = t->n;
+
+  while(hi - lo > 1){
+    int mid = (lo + hi) / 2;
+    if(t->s[mid].addr <= pc)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  if(t->n == 0 || t->s[lo].addr > pc)
+    return 0;
+  return &t->s[lo];
+}
+
+void
+readsamples(void)
+{
+  int n, cap = 0;
+
+  for(;;){
+    if(nsample + CHUNK > cap){
+      struct profsample *s;
+      cap = cap ? 2*cap : 16*CHUNK;
+      if((s = malloc(cap * sizeof(*s))) == 0){
+        fprintf(2, "prof: out of memory\n");
+        exit(1);
+      }
+      if(nsample > 0)
+        memmove(s, samples, nsample * sizeof(*s));
+      free(samples);
+      samples = s;
+    }
+    if((n = profread(samples + nsample, CHUNK)) <= 0)
+      break;
+    nsample += n;
+  }
+}
+
+void
+printpct(int n, int total)
+{
+  int x = n * 1000 / total;
+
+  printf("%d.%d%%", x / 10, x % 10);
+  if(x < 100)
+    printf(" ");
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct profsample junk[CHUNK];
+  struct sym *sym, **top;
+  char symfile[64], *base, *p;
+  int i, j, k, hz, ntop, pid, nsym, lost, other, counted;
+
+  hz = 1000;
+  ntop = 20;
+  for(i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2){
+    if(strcmp(argv[i], "-r") == 0)
+      hz = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-n") == 0)
+      ntop = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i >= argc || argv[i][0] == '-' || hz <= 0 || ntop <= 0){
+    fprintf(2, "usage: prof [-r hz] [-n top] command [args...]\n");
+    exit(1);
+  }
+
+  // throw away old samples.
+  while(profread(junk, CHUNK) > 0)
+    ;
+  if(prof(hz) < 0){
+    fprintf(2, "prof: can't sample at %d hz\n", hz);
+    exit(1);
+  }
+  if((pid = fork()) == 0){
+    exec(argv[i], argv + i);
+    fprintf(2, "prof: exec %s failed\n", argv[i]);
+    exit(1);
+  }
+  if(pid > 0)
+    wait(0);
+  prof(0);
+  if(pid < 0){
+    fprintf(2, "prof: fork failed\n");
+    exit(1);
+  }
+  readsamples();
+
+  loadsyms(&ktab, "/kernel.sym", 0);
+  for(base = p = argv[i]; *p; p++)
+    if(*p == '/')
+      base = p + 1;
+  if(strlen(base) + 5 > sizeof(symfile)){
+    fprintf(2, "prof: name too long\n");
+    exit(1);
+  }
+  strcpy(symfile, base);
+  strcpy(symfile + strlen(base), ".sym");
+  loadsyms(&utab, symfile, 1);
+
+  lost = other = counted = 0;
+  for(k = 0; k < nsample; k++){
+    struct profsample *s = &samples[k];
+    if(s->depth == 0){
+      lost += s->pc[0];
+      continue;
+    }
+    if(s->user){
+      if(s->pid != pid || (sym = lookup(&utab, s->pc[0])) == 0){
+        other++;
+        continue;
+      }
+      sym->self++;
+      sym->total++;
+      counted++;
+      continue;
+    }
+    counted++;
+    for(j = 0; j < s->depth; j++){
+      // return addresses point after the call.
+      if((sym = lookup(&ktab, j == 0 ? s->pc[j] : s->pc[j] - 1)) == 0)
+        continue;
+      if(j == 0)
+        sym->self++;
+      if(sym->stamp != k){
+        sym->stamp = k;
+        sym->total++;
+      }
+    }
+  }
+
+  printf("%d samples at %d hz", counted + other, hz);
+  if(other)
+    printf(", %d in other user processes", other);
+  if(lost)
+    printf(", %d lost", lost);
+  printf("\n");
+  if(counted + other == 0)
+    exit(0);
+
+  // the hottest functions by self, then by total.
+  nsym = 0;
+  if((top = malloc((ktab.n + utab.n) * sizeof(*top))) == 0){
+    fprintf(2, "prof: out of memory\n");
+    exit(1);
+  }
+  for(k = 0; k < ktab.n + utab.n; k++){
+    sym = k < ktab.n ? &ktab.s[k] : &utab.s[k - ktab.n];
+    if(sym->total == 0)
+      continue;
+    for(j = nsym; j > 0 && (top[j-1]->self < sym->self ||
+        (top[j-1]->self == sym->self && top[j-1]->total < sym->total)); j--)
+      top[j] = top[j-1];
+    top[j] = sym;
+    nsym++;
+  }
+
+  printf("  self   total\n");
+  for(k = 0; k < nsym && k < ntop; k++){
+    printpct(top[k]->self, counted + other);
+    printf("  ");
+    printpct(top[k]->total, counted + other);
+    printf("  %s%s\n", top[k]->user ? "" : "[k] ", top[k]->name);
+  }
+  exit(0);
+}
@@ -0,0 +1,121 @@
+// Parallel sum: add up a large array with 1, 2, ... nthreads
+// clone()d threads and report how the time scales.
+//
+// usage: psum [-t nthreads] [-n kints] [-r rounds]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define USPERTICK 100000  // timerinit(): 1000000 cycles at 10MHz
+#define MAXT 8
+
+int *a;
+int n, rounds;
+
+// one cache line per thread, so the partial sums
+// don't bounce a shared line between harts.
+struct {
+  uint64 sum;
+  char pad[56];
+} part[MAXT];
+
+struct job {
+  int id;
+  int lo, hi;
+};
+struct job jobs[MAXT];
+
+void
+sumrange(void *arg)
+{
+  struct job *j = arg;
+  uint64 s = 0;
+  int i, r;
+
+  for(r = 0; r < rounds; r++)
+    for(i = j->lo; i < j->hi; i++)
+      s += a[i];
+  part[j->id].sum = s;
+}
+
+int
+run(int nt, uint64 *total)
+{
+  int i, t0, tid[MAXT];
+
+  t0 = uptime();
+  for(i = 0; i < nt; i++){
+    jobs[i].id = i;
+    jobs[i].lo = (uint64)n * i / nt;
+    jobs[i].hi = (uint64)n * (i+1) / nt;
+  }
+  // the calling thread takes slice 0 itself.
+  for(i = 1; i < nt; i++){
+    if((tid[i] = thread_create(sumrange, &jobs[i])) < 0){
+      fprintf(2, "psum: thread_create failed\n");
+      exit(1);
+    }
+  }
+  sumrange(&jobs[0]);
+  for(i = 1; i < nt; i++)
+    thread_join(tid[i]);
+
+  *total = 0;
+  for(i = 0; i < nt; i++)
+    *total += part[i].sum;
+  return uptime() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, nt, t, t1;
+  uint64 total, want;
+
+  nt = 4;
+  n = 1024 * 1024;
+  rounds = 10;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-t") == 0)
+      nt = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-n") == 0)
+      n = atoi(argv[i+1]) * 1024;
+    else if(strcmp(argv[i], "-r") == 0)
+      rounds = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i < argc || nt <= 0 || nt > MAXT || n <= 0 || rounds <= 0){
+    fprintf(2, "usage: psum [-t nthreads] [-n kints] [-r rounds]\n");
+    exit(1);
+  }
+
+  if((a = (int*)sbrk(n * sizeof(int))) == (int*)-1){
+    fprintf(2, "psum: sbrk failed\n");
+    exit(1);
+  }
+  want = 0;
+  for(i = 0; i < n; i++){
+    a[i] = i % 1000;
+    want += a[i];
+  }
+  want *= rounds;
+
+  printf("psum: %d ints, %d rounds\n", n, rounds);
+  t1 = 0;
+  for(i = 1; i <= nt; i *= 2){
+    t = run(i, &total);
+    if(total != want){
+      fprintf(2, "psum: %d threads: wrong sum\n", i);
+      exit(1);
+    }
+    if(i == 1)
+      t1 = t;
+    printf("%d threads: %d ticks (%d ms)", i, t, t * (USPERTICK / 1000));
+    if(i > 1 && t > 0)
+      printf(", speedup x%d.%d", t1 / t, (t1 * 10 / t) % 10);
+    printf("\n");
+  }
+  exit(0);
+}
@@ -1,8 +1,17 @@
 // Shell.
+//
+// Simple commands and pipelines of them are started with
+// spawn() straight from the shell, with no shell process in
+// between; anything else (&, or a ( ) block in a pipeline)
+// runs in a forked copy of the shell, as it always has.
+//
+// Builtins: cd dir, and time cmd, which runs cmd and then
+// prints how many clock ticks it took.
 
 #include "kernel/types.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
+#include "kernel/fs.h"
 
 // Parsed command representation
 #define EXEC  1
@@ -49,9 +58,64 @@ struct backcmd {
   struct cmd *cmd;
 };
 
+#define NHASH 16
+
 int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
+void freecmd(struct cmd*);
+
+// Commands are found in the current directory or else in /.
+// Names found in / are remembered here, so that running them
+// again skips the failed lookup in the current directory.
+// cd forgets them all.
+char hash[NHASH][DIRSIZ+1];
+
+int
+hashof(char *s)
+{
+  uint h;
+
+  for(h = 0; *s; s++)
+    h = h * 31 + (uchar)*s;
+  return h % NHASH;
+}
+
+// spawn path, or exec it if fdmap is 0.
+int
+launch(char *path, char **argv, int *fdmap)
+{
+  if(fdmap)
+    return spawn(path, argv, fdmap);
+  return exec(path, argv);
+}
+
+// start command argv[0] as launch() does, looking for it
+// where it was found last time, in the current directory,
+// then in /.
+int
+start(char **argv, int *fdmap)
+{
+  char path[DIRSIZ+2], *name;
+  int h, pid;
+
+  name = argv[0];
+  if(strchr(name, '/') || strlen(name) > DIRSIZ)
+    return launch(name, argv, fdmap);
+  h = hashof(name);
+  path[0] = '/';
+  strcpy(path + 1, name);
+  if(strcmp(hash[h], name) == 0){
+    if((pid = launch(path, argv, fdmap)) >= 0)
+      return pid;
+    hash[h][0] = 0;
+  }
+  if((pid = launch(name, argv, fdmap)) >= 0)
+    return pid;
+  if((pid = launch(path, argv, fdmap)) >= 0)
+    strcpy(hash[h], name);
+  return pid;
+}
 
 // Execute cmd.  Never returns.
 void
@@ -75,7 +139,7 @@ runcmd(struct cmd *cmd)
     ecmd = (struct execcmd*)cmd;
     if(ecmd->argv[0] == 0)
       exit(1);
-    exec(ecmd->argv[0], ecmd->argv);
+    start(ecmd->argv, 0);
     fprintf(2, "exec %s failed\n", ecmd->argv[0]);
     break;
 
@@ -130,6 +194,121 @@ runcmd(struct cmd *cmd)
   exit(0);
 }
 
+// is cmd a command with perhaps some redirections?
+int
+simple(struct cmd *cmd)
+{
+  while(cmd->type == REDIR)
+    cmd = ((struct redircmd*)cmd)->cmd;
+  return cmd->type == EXEC;
+}
+
+// spawn simple command cmd with in and out, which the caller
+// still owns, as its stdin and stdout, unless it redirects
+// them. Returns the pid, or -1.
+int
+startcmd(struct cmd *cmd, int in, int out)
+{
+  int fd, i, pid, fdmap[3], opened[3];
+  struct execcmd *ecmd;
+  struct redircmd *rcmd;
+
+  fdmap[0] = in;
+  fdmap[1] = out;
+  fdmap[2] = 2;
+  memset(opened, 0, sizeof(opened));
+  pid = -1;
+  // the innermost redirection of an fd is the one
+  // that counts, as in runcmd().
+  for(; cmd->type == REDIR; cmd = rcmd->cmd){
+    rcmd = (struct redircmd*)cmd;
+    if((fd = open(rcmd->file, rcmd->mode)) < 0){
+      fprintf(2, "open %s failed\n", rcmd->file);
+      goto out;
+    }
+    if(opened[rcmd->fd])
+      close(fdmap[rcmd->fd]);
+    fdmap[rcmd->fd] = fd;
+    opened[rcmd->fd] = 1;
+  }
+  ecmd = (struct execcmd*)cmd;
+  if(ecmd->argv[0] == 0)
+    goto out;
+  if((pid = start(ecmd->argv, fdmap)) < 0)
+    fprintf(2, "exec %s failed\n", ecmd->argv[0]);
+out:
+  for(i = 0; i < 3; i++)
+    if(opened[i])
+      close(fdmap[i]);
+  return pid;
+}
+
+// run a pipeline of simple commands (perhaps just one) and
+// wait for them all. The shell makes each pipe and spawns
+// each command itself, closing its copies of the pipe ends
+// as it goes. Returns -1, having run nothing, if some stage
+// isn't simple.
+int
+runpipe(struct cmd *cmd)
+{
+  struct cmd *c, *stage;
+  int p[2], in, out, n;
+
+  for(c = cmd; c->type == PIPE; c = ((struct pipecmd*)c)->right)
+    if(!simple(((struct pipecmd*)c)->left))
+      return -1;
+  if(!simple(c))
+    return -1;
+
+  in = 0;
+  n = 0;
+  for(c = cmd; ; c = ((struct pipecmd*)c)->right){
+    if(c->type == PIPE){
+      stage = ((struct pipecmd*)c)->left;
+      if(pipe(p) < 0){
+        fprintf(2, "pipe failed\n");
+        break;
+      }
+      out = p[1];
+    } else {
+      stage = c;
+      out = 1;
+    }
+    if(startcmd(stage, in, out) >= 0)
+      n++;
+    if(in != 0)
+      close(in);
+    if(c->type != PIPE)
+      break;
+    close(p[1]);
+    in = p[0];
+  }
+  if(c->type == PIPE && in != 0)
+    close(in);
+  while(n-- > 0)
+    wait(0);
+  return 0;
+}
+
+// run cmd and wait for it, in the shell where possible.
+void
+runline(struct cmd *cmd)
+{
+  struct listcmd *lcmd;
+
+  if(cmd->type == LIST){
+    lcmd = (struct listcmd*)cmd;
+    runline(lcmd->left);
+    runline(lcmd->right);
+    return;
+  }
+  if(runpipe(cmd) == 0)
+    return;
+  if(fork1() == 0)
+    runcmd(cmd);
+  wait(0);
+}
+
 int
 getcmd(char *buf, int nbuf)
 {
@@ -145,7 +324,9 @@ int
 main(void)
 {
   static char buf[100];
-  int fd;
+  struct cmd *cmd;
+  char *s;
+  int fd, t0;
 
   // Ensure that three file descriptors are open.
   while((fd = open("console", O_RDWR)) >= 0){
@@ -162,11 +343,21 @@ main(void)
       buf[strlen(buf)-1] = 0;  // chop \n
       if(chdir(buf+3) < 0)
         fprintf(2, "cannot cd %s\n", buf+3);
+      memset(hash, 0, sizeof(hash));
       continue;
     }
-    if(fork1() == 0)
-      runcmd(parsecmd(buf));
-    wait(0);
+    s = buf;
+    t0 = -1;
+    if(memcmp(s, "time", 4) == 0 && (s[4] == ' ' || s[4] == '\t')){
+      s += 5;
+      t0 = uptime();
+    }
+    if((cmd = parsecmd(s)) != 0){
+      runline(cmd);
+      freecmd(cmd);
+    }
+    if(t0 >= 0)
+      fprintf(2, "%d ticks\n", uptime() - t0);
   }
   exit(0);
 }
@@ -319,6 +510,17 @@ peek(char **ps, char *es, char *toks)
   return *s && strchr(toks, *s);
 }
 
+int parseerr;
+
+// report a syntax error; parsecmd() will return 0.
+void
+syntax(char *msg)
+{
+  if(!parseerr)
+    fprintf(2, "%s\n", msg);
+  parseerr = 1;
+}
+
 struct cmd *parseline(char**, char*);
 struct cmd *parsepipe(char**, char*);
 struct cmd *parseexec(char**, char*);
@@ -330,12 +532,17 @@ parsecmd(char *s)
   char *es;
   struct cmd *cmd;
 
+  parseerr = 0;
   es = s + strlen(s);
   cmd = parseline(&s, es);
   peek(&s, es, "");
-  if(s != es){
+  if(s != es && !parseerr){
     fprintf(2, "leftovers: %s\n", s);
-    panic("syntax");
+    syntax("syntax");
+  }
+  if(parseerr){
+    freecmd(cmd);
+    return 0;
   }
   nulterminate(cmd);
   return cmd;
@@ -379,8 +586,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
 
   while(peek(ps, es, "<>")){
     tok = gettoken(ps, es, 0, 0);
-    if(gettoken(ps, es, &q, &eq) != 'a')
-      panic("missing file for redirection");
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("missing file for redirection");
+      break;
+    }
     switch(tok){
     case '<':
       cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -405,8 +614,10 @@ parseblock(char **ps, char *es)
     panic("parseblock");
   gettoken(ps, es, 0, 0);
   cmd = parseline(ps, es);
-  if(!peek(ps, es, ")"))
-    panic("syntax - missing )");
+  if(!peek(ps, es, ")")){
+    syntax("syntax - missing )");
+    return cmd;
+  }
   gettoken(ps, es, 0, 0);
   cmd = parseredirs(cmd, ps, es);
   return cmd;
@@ -431,13 +642,17 @@ parseexec(char **ps, char *es)
   while(!peek(ps, es, "|)&;")){
     if((tok=gettoken(ps, es, &q, &eq)) == 0)
       break;
-    if(tok != 'a')
-      panic("syntax");
+    if(tok != 'a'){
+      syntax("syntax");
+      break;
+    }
+    if(argc >= MAXARGS - 1){
+      syntax("too many args");
+      break;
+    }
     cmd->argv[argc] = q;
     cmd->eargv[argc] = eq;
     argc++;
-    if(argc >= MAXARGS)
-      panic("too many args");
     ret = parseredirs(ret, ps, es);
   }
   cmd->argv[argc] = 0;
@@ -491,3 +706,28 @@ nulterminate(struct cmd *cmd)
   }
   return cmd;
 }
+
+void
+freecmd(struct cmd *cmd)
+{
+  if(cmd == 0)
+    return;
+
+  switch(cmd->type){
+  case REDIR:
+    freecmd(((struct redircmd*)cmd)->cmd);
+    break;
+
+  case PIPE:
+  case LIST:
+    // pipecmd and listcmd are laid out alike.
+    freecmd(((struct pipecmd*)cmd)->left);
+    freecmd(((struct pipecmd*)cmd)->right);
+    break;
+
+  case BACK:
+    freecmd(((struct backcmd*)cmd)->cmd);
+    break;
+  }
+  free(cmd);
+}
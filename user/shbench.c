@@ -0,0 +1,102 @@
+// sh benchmark: run scripts of simple commands, pipelines and
+// command lists through sh, and time them, counting the fork(),
+// spawn() and exec() calls made.
+//
+// usage: shbench [-l lines]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/syscall.h"
+#include "kernel/sysstat.h"
+#include "user/user.h"
+
+#define SCRIPT "shbench.sh"
+#define LOG "shbench.log"
+
+char *lines[] = {
+  "echo hello",
+  "echo hello | cat | wc",
+  "echo hello > shbench.out ; cat < shbench.out",
+  "(echo hello ; echo world) | wc",
+};
+
+struct sysstat st[NSYSCALL];
+
+void
+count(uint64 *n)
+{
+  if(sysstat(SS_ALL, 0, st) < 0){
+    fprintf(2, "shbench: sysstat failed\n");
+    exit(1);
+  }
+  n[0] = st[SYS_fork].count;
+  n[1] = st[SYS_spawn].count;
+  n[2] = st[SYS_exec].count;
+}
+
+void
+script(char *line, int n)
+{
+  FILE *f;
+  int fd, i;
+
+  if((fd = open(SCRIPT, O_CREATE|O_TRUNC|O_WRONLY)) < 0 || (f = fdopen(fd, "w")) == 0){
+    fprintf(2, "shbench: cannot create %s\n", SCRIPT);
+    exit(1);
+  }
+  for(i = 0; i < n; i++)
+    fileprintf(f, "%s\n", line);
+  fclose(f);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *args[2];
+  int fdmap[3];
+  int i, n;
+  uint64 t0, t1, c0[3], c1[3];
+
+  n = 200;
+  if(argc == 3 && strcmp(argv[1], "-l") == 0)
+    n = atoi(argv[2]);
+  else if(argc != 1)
+    n = 0;
+  if(n <= 0){
+    fprintf(2, "usage: shbench [-l lines]\n");
+    exit(1);
+  }
+
+  printf("shbench: %d lines per script\n", n);
+  args[0] = "sh";
+  args[1] = 0;
+  for(i = 0; i < sizeof(lines) / sizeof(lines[0]); i++){
+    script(lines[i], n);
+    // sh's output and prompts go to LOG.
+    if((fdmap[0] = open(SCRIPT, O_RDONLY)) < 0 ||
+       (fdmap[1] = open(LOG, O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+      fprintf(2, "shbench: cannot open %s or %s\n", SCRIPT, LOG);
+      exit(1);
+    }
+    fdmap[2] = fdmap[1];
+    count(c0);
+    clock_gettime(&t0);
+    if(spawn("sh", args, fdmap) < 0){
+      fprintf(2, "shbench: cannot run sh\n");
+      exit(1);
+    }
+    wait(0);
+    clock_gettime(&t1);
+    count(c1);
+    close(fdmap[0]);
+    close(fdmap[1]);
+    printf("%s: %l ms, %l lines/s, %l forks, %l spawns, %l execs\n", lines[i],
+           (t1 - t0) / 1000000, persec(n, t1 - t0),
+           c1[0] - c0[0], c1[1] - c0[1] - 1, c1[2] - c0[2]);
+  }
+  unlink(SCRIPT);
+  unlink(LOG);
+  unlink("shbench.out");
+  exit(0);
+}
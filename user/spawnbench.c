@@ -0,0 +1,100 @@
+// Compare process creation rates: fork()+exec() against spawn().
+//
+// usage: spawnbench [-n iters] [-m kbytes]
+//
+// -m grows the parent's heap first, which makes fork() copy
+// more memory before exec() throws it away; spawn() doesn't care.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define USPERTICK 100000  // timerinit(): 1000000 cycles at 10MHz
+
+char *cmd[] = { "echo", 0 };
+
+// children get no stdout, so echo's output goes nowhere.
+int fdmap[3] = { 0, -1, 2 };
+
+int
+forkexec(int n)
+{
+  int i, pid, t0;
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "spawnbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(1);
+      exec(cmd[0], cmd);
+      exit(1);
+    }
+    wait(0);
+  }
+  return uptime() - t0;
+}
+
+int
+spawns(int n)
+{
+  int i, t0;
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    if(spawn(cmd[0], cmd, fdmap) < 0){
+      fprintf(2, "spawnbench: spawn failed\n");
+      exit(1);
+    }
+    wait(0);
+  }
+  return uptime() - t0;
+}
+
+void
+report(char *what, int n, int t)
+{
+  printf("%s: %d in %d ticks", what, n, t);
+  if(t > 0)
+    printf(", %d us each, %d/s", t * USPERTICK / n, n * (1000000 / USPERTICK) / t);
+  printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, kb;
+
+  n = 200;
+  kb = 0;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-n") == 0)
+      n = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-m") == 0)
+      kb = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i < argc || n <= 0){
+    fprintf(2, "usage: spawnbench [-n iters] [-m kbytes]\n");
+    exit(1);
+  }
+
+  if(kb > 0){
+    char *p = sbrk(kb * 1024);
+    if(p == (char*)-1){
+      fprintf(2, "spawnbench: sbrk failed\n");
+      exit(1);
+    }
+    // touch the memory so fork() has to copy it.
+    memset(p, 1, kb * 1024);
+  }
+
+  printf("spawnbench: %s, parent heap %d KB\n", cmd[0], kb);
+  report("fork+exec", n, forkexec(n));
+  report("spawn", n, spawns(n));
+  exit(0);
+}
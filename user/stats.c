@@ -0,0 +1,27 @@
+// stats: print the kernel's spinlock statistics.
+//
+// For each lock name (summed over all locks of that name):
+// acquisitions, acquisitions that had to wait, total spin
+// iterations, and the longest hold in cycles. [mcs] marks
+// queued locks.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define SZ 4096
+
+char buf[SZ];
+
+int
+main(void)
+{
+  int n;
+
+  if((n = statistics(buf, SZ)) < 0){
+    fprintf(2, "stats: can't read statistics\n");
+    exit(1);
+  }
+  write(1, buf, n);
+  exit(0);
+}
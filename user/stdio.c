@@ -0,0 +1,231 @@
+// Buffered output streams: stdout, stderr, and streams
+// made by fdopen().
+//
+// A stream gathers output in its buffer and hands it to
+// write() when the buffer fills (_IOFBF), also at each
+// newline (_IOLBF), or also at the end of each printf()-style
+// call (_IONBF). stdout is line buffered if it is the console
+// and fully buffered otherwise; stderr is _IONBF. exit(),
+// fork(), exec() and spawn() flush every stream first, so
+// output isn't lost or written twice.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+static FILE sout = { .fd = 1, .mode = -1 };  // mode decided on first use
+static FILE serr = { .fd = 2, .mode = _IONBF };
+FILE *stdout = &sout;
+FILE *stderr = &serr;
+
+static FILE *streams;  // fdopen()ed, linked by next
+
+int sys_exit(int) __attribute__((noreturn));
+int sys_fork(void);
+int sys_exec(char*, char**);
+int sys_spawn(char*, char**, int*);
+
+void
+finit(FILE *f, int fd, int mode)
+{
+  memset(f, 0, sizeof(*f));
+  f->fd = fd;
+  f->mode = mode;
+}
+
+void
+flock(FILE *f)
+{
+  while(__sync_lock_test_and_set(&f->lock, 1) != 0)
+    ;
+}
+
+void
+funlock(FILE *f)
+{
+  __sync_lock_release(&f->lock);
+}
+
+// write out f's buffer. the caller holds f's lock.
+static int
+drain(FILE *f)
+{
+  int i, n;
+
+  for(i = 0; i < f->n; i += n){
+    if((n = write(f->fd, f->buf + i, f->n - i)) <= 0){
+      f->n = 0;
+      return -1;
+    }
+  }
+  f->n = 0;
+  return 0;
+}
+
+// add c to f's buffer. the caller holds f's lock.
+void
+putch(FILE *f, int c)
+{
+  struct stat st;
+
+  if(f->mode < 0){
+    if(fstat(f->fd, &st) == 0 && st.type == T_DEVICE)
+      f->mode = _IOLBF;
+    else
+      f->mode = _IOFBF;
+  }
+  f->buf[f->n++] = c;
+  if(f->n == BUFSIZ || (c == '\n' && f->mode == _IOLBF))
+    drain(f);
+}
+
+// the end of a printf()-style call on f, with its lock held.
+void
+fendcall(FILE *f)
+{
+  if(f->mode == _IONBF)
+    drain(f);
+}
+
+FILE*
+fdopen(int fd, char *mode)
+{
+  FILE *f;
+
+  if(mode[0] != 'w' && mode[0] != 'a')
+    return 0;  // output only
+  if((f = malloc(sizeof(*f))) == 0)
+    return 0;
+  finit(f, fd, -1);
+  flock(stdout);  // guards streams
+  f->next = streams;
+  streams = f;
+  funlock(stdout);
+  return f;
+}
+
+// _IONBF, _IOLBF or _IOFBF; flushes first.
+int
+setvbuf(FILE *f, int mode)
+{
+  if(mode != _IONBF && mode != _IOLBF && mode != _IOFBF)
+    return -1;
+  flock(f);
+  drain(f);
+  f->mode = mode;
+  funlock(f);
+  return 0;
+}
+
+int
+fputc(int c, FILE *f)
+{
+  flock(f);
+  putch(f, c);
+  fendcall(f);
+  funlock(f);
+  return c & 0xff;
+}
+
+int
+fputs(const char *s, FILE *f)
+{
+  flock(f);
+  while(*s)
+    putch(f, *s++);
+  fendcall(f);
+  funlock(f);
+  return 0;
+}
+
+// write n items of size bytes each; returns n.
+// large writes skip the buffer.
+int
+fwrite(const void *p, uint size, uint n, FILE *f)
+{
+  const char *s = p;
+  uint len = size * n;
+  int r;
+
+  flock(f);
+  if(len >= BUFSIZ && f->mode != _IOLBF){
+    r = drain(f);
+    if(r == 0 && write(f->fd, s, len) != len)
+      r = -1;
+  } else {
+    while(len-- > 0)
+      putch(f, *s++);
+    fendcall(f);
+    r = 0;
+  }
+  funlock(f);
+  return r < 0 ? 0 : n;
+}
+
+// flush f, or every stream if f is 0.
+int
+fflush(FILE *f)
+{
+  int r;
+
+  if(f == 0){
+    r = fflush(stdout) | fflush(stderr);
+    for(f = streams; f; f = f->next)
+      r |= fflush(f);
+    return r;
+  }
+  flock(f);
+  r = drain(f);
+  funlock(f);
+  return r;
+}
+
+int
+fclose(FILE *f)
+{
+  FILE **pp;
+  int r;
+
+  r = fflush(f);
+  flock(stdout);
+  for(pp = &streams; *pp; pp = &(*pp)->next){
+    if(*pp == f){
+      *pp = f->next;
+      break;
+    }
+  }
+  funlock(stdout);
+  if(close(f->fd) < 0)
+    r = -1;
+  if(f != stdout && f != stderr)
+    free(f);
+  return r;
+}
+
+int
+exit(int status)
+{
+  fflush(0);
+  sys_exit(status);
+}
+
+int
+fork(void)
+{
+  fflush(0);
+  return sys_fork();
+}
+
+int
+exec(char *path, char **argv)
+{
+  fflush(0);
+  return sys_exec(path, argv);
+}
+
+int
+spawn(char *path, char **argv, int *fdmap)
+{
+  fflush(0);
+  return sys_spawn(path, argv, fdmap);
+}
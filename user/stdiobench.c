@@ -0,0 +1,164 @@
+// Buffered output benchmark: write lines of printf() output
+// to a file one byte per write() (how printf() used to work),
+// then through a stream in each buffering mode, and count
+// the write() calls and the time each way takes. Then run
+// some output-heavy tools with their stdout sent to a file.
+//
+// usage: stdiobench [-n lines]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/syscall.h"
+#include "kernel/sysstat.h"
+#include "user/user.h"
+
+#define OUT "stdiobench.out"
+
+struct sysstat st[NSYSCALL];
+
+char *tools[][3] = {
+  { "ls", 0 },
+  { "sysstat", 0 },
+  { "ls", "/", 0 },
+};
+
+uint64
+writes(int which, int id)
+{
+  if(sysstat(which, id, st) < 0){
+    fprintf(2, "stdiobench: sysstat failed\n");
+    exit(1);
+  }
+  return st[SYS_write].count;
+}
+
+uint64
+now(void)
+{
+  uint64 t;
+
+  clock_gettime(&t);
+  return t;
+}
+
+void
+report(char *what, uint64 w, uint64 t)
+{
+  printf("%s: %l writes, %l us\n", what, w, t / 1000);
+}
+
+int
+create(void)
+{
+  int fd;
+
+  if((fd = open(OUT, O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+    fprintf(2, "stdiobench: cannot create %s\n", OUT);
+    exit(1);
+  }
+  return fd;
+}
+
+// one write() per byte.
+void
+bytewise(int n)
+{
+  uint64 w0, t0;
+  FILE f;
+  int fd, i, j;
+
+  fd = create();
+  w0 = writes(SS_PROC, getpid());
+  t0 = now();
+  for(i = 0; i < n; i++){
+    // format the line into f's buffer, and send it a byte at a time.
+    finit(&f, -1, _IOFBF);
+    fileprintf(&f, "%d %d %d %s\n", i, i * 7, -i, "stdiobench");
+    for(j = 0; j < f.n; j++)
+      write(fd, &f.buf[j], 1);
+  }
+  report("byte writes", writes(SS_PROC, getpid()) - w0, now() - t0);
+  close(fd);
+}
+
+void
+buffered(char *what, int mode, int n)
+{
+  uint64 w0, t0;
+  FILE *f;
+  int i;
+
+  if((f = fdopen(create(), "w")) == 0){
+    fprintf(2, "stdiobench: fdopen failed\n");
+    exit(1);
+  }
+  setvbuf(f, mode);
+  w0 = writes(SS_PROC, getpid());
+  t0 = now();
+  for(i = 0; i < n; i++)
+    fileprintf(f, "%d %d %d %s\n", i, i * 7, -i, "stdiobench");
+  fflush(f);
+  report(what, writes(SS_PROC, getpid()) - w0, now() - t0);
+  fclose(f);
+}
+
+// run argv with its stdout sent to OUT. counts every hart's
+// writes, so anything else running adds to the count.
+void
+tool(char **argv)
+{
+  int fdmap[3];
+  uint64 w0, t0;
+  char what[32];
+  int i;
+
+  fdmap[0] = 0;
+  fdmap[1] = create();
+  fdmap[2] = 2;
+  w0 = writes(SS_ALL, 0);
+  t0 = now();
+  if(spawn(argv[0], argv, fdmap) < 0){
+    fprintf(2, "stdiobench: cannot run %s\n", argv[0]);
+    exit(1);
+  }
+  wait(0);
+  t0 = now() - t0;
+  w0 = writes(SS_ALL, 0) - w0;
+  close(fdmap[1]);
+
+  strcpy(what, argv[0]);
+  for(i = 1; argv[i]; i++){
+    strcpy(what + strlen(what), " ");
+    strcpy(what + strlen(what), argv[i]);
+  }
+  report(what, w0, t0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n;
+
+  n = 1000;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-n") == 0)
+      n = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i < argc || n <= 0){
+    fprintf(2, "usage: stdiobench [-n lines]\n");
+    exit(1);
+  }
+
+  printf("stdiobench: %d lines\n", n);
+  bytewise(n);
+  buffered("_IONBF", _IONBF, n);
+  buffered("_IOLBF", _IOLBF, n);
+  buffered("_IOFBF", _IOFBF, n);
+  for(i = 0; i < sizeof(tools) / sizeof(tools[0]); i++)
+    tool(tools[i]);
+  unlink(OUT);
+  exit(0);
+}
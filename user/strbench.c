@@ -0,0 +1,260 @@
+// Check the word-at-a-time string and memory routines in
+// ulib.c against simple byte loops, at every alignment and
+// many lengths, then time both versions.
+//
+// usage: strbench [-n kbytes]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define BUFSZ 8192
+#define WIDTH 128     // span of the correctness checks
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+char a[BUFSZ], b[BUFSZ], c[BUFSZ], d[BUFSZ];
+int sizes[] = { 8, 64, 512, 4096 };
+int total;    // bytes handled per measurement
+int bad;
+
+// the byte loops ulib.c used to have.
+
+uint
+bstrlen(const char *s)
+{
+  int n;
+
+  for(n = 0; s[n]; n++)
+    ;
+  return n;
+}
+
+int
+bstrcmp(const char *p, const char *q)
+{
+  while(*p && *p == *q)
+    p++, q++;
+  return (uchar)*p - (uchar)*q;
+}
+
+char*
+bstrchr(const char *s, char c)
+{
+  for(; *s; s++)
+    if(*s == c)
+      return (char*)s;
+  return 0;
+}
+
+char*
+bstrcpy(char *s, const char *t)
+{
+  char *os;
+
+  os = s;
+  while((*s++ = *t++) != 0)
+    ;
+  return os;
+}
+
+void*
+bmemset(void *dst, int c, uint n)
+{
+  char *cdst = (char *) dst;
+  int i;
+
+  for(i = 0; i < n; i++)
+    cdst[i] = c;
+  return dst;
+}
+
+void*
+bmemmove(void *vdst, const void *vsrc, int n)
+{
+  char *dst = vdst;
+  const char *src = vsrc;
+
+  if(src > dst){
+    while(n-- > 0)
+      *dst++ = *src++;
+  } else {
+    dst += n;
+    src += n;
+    while(n-- > 0)
+      *--dst = *--src;
+  }
+  return vdst;
+}
+
+void*
+bmemchr(const void *s, int c, uint n)
+{
+  const uchar *p = s;
+
+  for(; n > 0; n--, p++)
+    if(*p == (uchar)c)
+      return (void*)p;
+  return 0;
+}
+
+int
+bmemcmp(const void *s1, const void *s2, uint n)
+{
+  const uchar *p1 = s1, *p2 = s2;
+
+  for(; n > 0; n--, p1++, p2++)
+    if(*p1 != *p2)
+      return *p1 - *p2;
+  return 0;
+}
+
+uint seed = 1;
+
+int
+rnd(int n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) % n;
+}
+
+int
+sign(int x)
+{
+  return (x > 0) - (x < 0);
+}
+
+void
+fail(char *what, int oa, int ob, int n)
+{
+  if(bad++ < 10)
+    printf("strbench: %s wrong, offsets %d %d, length %d\n", what, oa, ob, n);
+}
+
+// a and b hold the same random string of length n at
+// offsets oa and ob, except b may differ at one byte.
+void
+check(int oa, int ob, int n)
+{
+  int i, m;
+  char ch;
+
+  for(i = 0; i < 2*WIDTH; i++){
+    a[i] = 'a' + rnd(4);
+    b[i] = a[i];
+  }
+  for(i = 0; i < n; i++)
+    b[ob + i] = a[oa + i];
+  a[oa + n] = b[ob + n] = 0;
+  if(n > 0 && rnd(2))
+    b[ob + rnd(n)] = rnd(256);
+
+  if(strlen(a + oa) != bstrlen(a + oa))
+    fail("strlen", oa, ob, n);
+  if(sign(strcmp(a + oa, b + ob)) != sign(bstrcmp(a + oa, b + ob)))
+    fail("strcmp", oa, ob, n);
+  if(sign(memcmp(a + oa, b + ob, n)) != sign(bmemcmp(a + oa, b + ob, n)))
+    fail("memcmp", oa, ob, n);
+  ch = "abcdz"[rnd(5)];
+  if(strchr(a + oa, ch) != bstrchr(a + oa, ch))
+    fail("strchr", oa, ob, n);
+  if(memchr(a + oa, ch, n) != bmemchr(a + oa, ch, n))
+    fail("memchr", oa, ob, n);
+
+  memmove(c, a, 2*WIDTH);
+  memmove(d, a, 2*WIDTH);
+  m = rnd(WIDTH);
+  bmemmove(c + oa, c + ob, m);
+  if(memmove(d + oa, d + ob, m) != d + oa || memcmp(c, d, 2*WIDTH) != 0)
+    fail("memmove", oa, ob, m);
+  bmemset(c + ob, ch, m);
+  if(memset(d + ob, ch, m) != d + ob || memcmp(c, d, 2*WIDTH) != 0)
+    fail("memset", oa, ob, m);
+  bstrcpy(c + ob, a + oa);
+  if(strcpy(d + ob, a + oa) != d + ob || memcmp(c, d, 2*WIDTH) != 0)
+    fail("strcpy", oa, ob, n);
+}
+
+// KB/s for n-byte operations on a+off, with
+// the word versions if fast, else the byte ones.
+uint64
+timeit(int op, int fast, int n, int off)
+{
+  uint64 t0, t1;
+  int i, iters = total / n;
+  volatile int sink = 0;
+
+  // strings of length n - 1; b matches a but for the last byte.
+  memset(a, 'x', BUFSZ);
+  a[off + n - 1] = 0;
+  memmove(b, a, BUFSZ);
+  b[off + n - 2] = 'y';
+
+  clock_gettime(&t0);
+  for(i = 0; i < iters; i++){
+    switch(op){
+    case 0:
+      sink += fast ? strlen(a + off) : bstrlen(a + off);
+      break;
+    case 1:
+      sink += fast ? strcmp(a + off, b + off) : bstrcmp(a + off, b + off);
+      break;
+    case 2:
+      sink += (fast ? strchr(a + off, 'q') : bstrchr(a + off, 'q')) != 0;
+      break;
+    case 3:
+      fast ? memset(c + off, i, n) : bmemset(c + off, i, n);
+      break;
+    case 4:
+      fast ? memmove(c + off, a, n) : bmemmove(c + off, a, n);
+      break;
+    case 5:
+      sink += fast ? memcmp(a + off, b + off, n) : bmemcmp(a + off, b + off, n);
+      break;
+    case 6:
+      sink += (fast ? memchr(a + off, 'q', n) : bmemchr(a + off, 'q', n)) != 0;
+      break;
+    }
+  }
+  clock_gettime(&t1);
+  if(t1 == t0)
+    t1++;
+  return persec((uint64)iters * n, t1 - t0) / 1024;
+}
+
+char *names[] = { "strlen", "strcmp", "strchr", "memset", "memmove", "memcmp", "memchr" };
+
+int
+main(int argc, char *argv[])
+{
+  int i, op, oa, ob, n;
+
+  total = 1024 * 1024;
+  if(argc == 3 && strcmp(argv[1], "-n") == 0)
+    total = atoi(argv[2]) * 1024;
+  else if(argc != 1)
+    total = 0;
+  if(total < BUFSZ){
+    fprintf(2, "usage: strbench [-n kbytes]\n");
+    exit(1);
+  }
+
+  for(oa = 0; oa < 16; oa++)
+    for(ob = 0; ob < 16; ob++)
+      for(n = 0; n < 80; n++)
+        check(oa, ob, n);
+  if(bad){
+    printf("strbench: %d failures\n", bad);
+    exit(1);
+  }
+  printf("strbench: checked against byte loops\n");
+
+  printf("KB/s, byte loops -> words, aligned / misaligned by 3\n");
+  for(op = 0; op < NELEM(names); op++){
+    for(i = 0; i < NELEM(sizes); i++){
+      n = sizes[i];
+      printf("%s %d: %l -> %l", names[op], n, timeit(op, 0, n, 0), timeit(op, 1, n, 0));
+      printf(" / %l -> %l\n", timeit(op, 0, n, 3), timeit(op, 1, n, 3));
+    }
+  }
+  exit(0);
+}
@@ -0,0 +1,99 @@
+// Print the hottest syscalls by total time, with their call
+// counts, mean latency, and latency histogram.
+//
+// usage: sysstat [-n top] [-c hart | -p pid]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/syscall.h"
+#include "kernel/sysname.h"
+#include "kernel/sysstat.h"
+#include "user/user.h"
+
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+struct sysstat st[NSYSCALL];
+
+char*
+name(int num)
+{
+  if(num > 0 && num < NELEM(syscall_name) && syscall_name[num])
+    return syscall_name[num];
+  return "?";
+}
+
+// print 2^n compactly: 512, 4K, 1M.
+void
+printpow(int n)
+{
+  if(n >= 20)
+    printf("%dM", 1 << (n - 20));
+  else if(n >= 10)
+    printf("%dK", 1 << (n - 10));
+  else
+    printf("%d", 1 << n);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, j, b, top, which, id, order[NSYSCALL];
+
+  top = 10;
+  which = SS_ALL;
+  id = 0;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-n") == 0)
+      top = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-c") == 0){
+      which = SS_CPU;
+      id = atoi(argv[i+1]);
+    } else if(strcmp(argv[i], "-p") == 0){
+      which = SS_PROC;
+      id = atoi(argv[i+1]);
+    } else
+      break;
+  }
+  if(i < argc || top <= 0){
+    fprintf(2, "usage: sysstat [-n top] [-c hart | -p pid]\n");
+    exit(1);
+  }
+
+  if(sysstat(which, id, st) < 0){
+    fprintf(2, "sysstat: no such %s\n", which == SS_CPU ? "hart" : "process");
+    exit(1);
+  }
+
+  // syscall numbers, hottest first.
+  for(i = 0; i < NSYSCALL; i++){
+    for(j = i; j > 0 && st[order[j-1]].cycles < st[i].cycles; j--)
+      order[j] = order[j-1];
+    order[j] = i;
+  }
+
+  printf("syscall         calls       cycles    mean\n");
+  for(i = 0; i < top && i < NSYSCALL; i++){
+    struct sysstat *s = &st[order[i]];
+    if(s->count == 0)
+      break;
+    printf("%s", name(order[i]));
+    for(j = strlen(name(order[i])); j < 14; j++)
+      printf(" ");
+    printf(" %l %l %l\n", s->count, s->cycles, s->cycles / s->count);
+    printf("   ");
+    for(b = 0; b < NHIST; b++){
+      if(s->hist[b] == 0)
+        continue;
+      if(b < NHIST-1){
+        printf(" <");
+        printpow(b + HISTSHIFT);
+      } else {
+        printf(" >=");
+        printpow(b - 1 + HISTSHIFT);
+      }
+      printf(":%d", s->hist[b]);
+    }
+    printf("\n");
+  }
+  exit(0);
+}
@@ -0,0 +1,162 @@
+// Kernel threads on top of clone(), and futex-based
+// mutexes and condition variables for them.
+//
+// A thread shares the caller's memory, open files and cwd,
+// and runs fn(arg) on a stack of its own taken from malloc().
+// The thread table is not locked, so create and join threads
+// from one thread only (usually main).
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define NTHREAD 64           // at most NPROC anyway
+#define TSTACKSIZE (4*4096)
+
+struct tstart {
+  void (*fn)(void*);
+  void *arg;
+};
+
+static struct {
+  int tid;
+  int done;                  // reaped by wait() already
+  void *stack;
+} threads[NTHREAD];
+
+// first code run by a new thread; fn must not simply
+// return, since the kernel leaves nowhere to return to.
+static void
+threadstart(void *a)
+{
+  struct tstart *t = a;
+
+  t->fn(t->arg);
+  exit(0);
+}
+
+// Start a thread running fn(arg).
+// Returns its thread id, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  int i, tid;
+  char *stack;
+  struct tstart *t;
+
+  for(i = 0; i < NTHREAD; i++)
+    if(threads[i].stack == 0)
+      break;
+  if(i == NTHREAD)
+    return -1;
+  if((stack = malloc(TSTACKSIZE)) == 0)
+    return -1;
+
+  // the start record lives at the top of the new stack.
+  t = (struct tstart*)(((uint64)stack + TSTACKSIZE - sizeof(*t)) & ~15L);
+  t->fn = fn;
+  t->arg = arg;
+  if((tid = clone(threadstart, t, t)) < 0){
+    free(stack);
+    return -1;
+  }
+  threads[i].tid = tid;
+  threads[i].done = 0;
+  threads[i].stack = stack;
+  return tid;
+}
+
+// Wait for thread tid to exit and free its stack.
+// Threads and children that exit in the meantime
+// are reaped too.
+// Returns 0, or -1 if tid is not a thread of ours.
+int
+thread_join(int tid)
+{
+  int i, j, pid;
+
+  for(i = 0; i < NTHREAD; i++)
+    if(threads[i].stack != 0 && threads[i].tid == tid)
+      break;
+  if(i == NTHREAD)
+    return -1;
+  while(!threads[i].done){
+    if((pid = wait(0)) < 0)
+      return -1;
+    for(j = 0; j < NTHREAD; j++)
+      if(threads[j].stack != 0 && threads[j].tid == pid)
+        threads[j].done = 1;
+  }
+  free(threads[i].stack);
+  threads[i].stack = 0;
+  return 0;
+}
+
+// Mutexes, after Drepper's "Futexes Are Tricky":
+// v is 0 when unlocked, 1 when locked, and 2 when
+// locked with (possibly) threads asleep in futex_wait().
+void
+mutex_init(struct mutex *m)
+{
+  m->v = 0;
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  int c;
+
+  if((c = __sync_val_compare_and_swap(&m->v, 0, 1)) == 0)
+    return;
+  if(c != 2)
+    c = __sync_lock_test_and_set(&m->v, 2);
+  while(c != 0){
+    futex_wait(&m->v, 2);
+    c = __sync_lock_test_and_set(&m->v, 2);
+  }
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(__sync_fetch_and_sub(&m->v, 1) != 1){
+    m->v = 0;
+    __sync_synchronize();
+    futex_wake(&m->v, 1);
+  }
+}
+
+// Condition variables. seq changes on every signal, so a
+// waiter that saw the old value can't miss a wakeup sent
+// between its mutex_unlock() and futex_wait().
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  int seq = c->seq;
+
+  mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  // others may be asleep on m too; lock it as contended.
+  while(__sync_lock_test_and_set(&m->v, 2) != 0)
+    futex_wait(&m->v, 2);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, NTHREAD);
+}
@@ -0,0 +1,87 @@
+// Print system activity every few seconds: how busy each
+// hart was, context switches, the run queue, memory, buffer
+// cache hit rate, log commits and disk operations.
+//
+// usage: top [-d seconds] [-n count]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/sysinfo.h"
+#include "user/user.h"
+
+struct sysinfo prev, cur;
+
+void
+get(struct sysinfo *info)
+{
+  if(sysinfo2(info, sizeof(*info)) < 0 || info->version < SYSINFO_VERSION){
+    fprintf(2, "top: sysinfo failed\n");
+    exit(1);
+  }
+}
+
+// n/d as a percentage, or "-" if d is 0.
+void
+pct(uint64 n, uint64 d)
+{
+  if(d == 0)
+    printf("   -");
+  else
+    printf("%d%%", (int)(n * 100 / d));
+}
+
+void
+report(void)
+{
+  int i;
+  uint64 busy, idle;
+
+  printf("procs %d, runnable %d, mem %dK used of %dK\n",
+         (int)cur.nproc, (int)cur.nrunnable,
+         (int)((cur.totalmem - cur.freemem) / 1024), (int)(cur.totalmem / 1024));
+  printf("bcache hits ");
+  pct(cur.bhit - prev.bhit, (cur.bhit - prev.bhit) + (cur.bmiss - prev.bmiss));
+  printf(", log commits %d, disk reads %d writes %d\n",
+         (int)(cur.ncommit - prev.ncommit), (int)(cur.nread - prev.nread),
+         (int)(cur.nwrite - prev.nwrite));
+  for(i = 0; i < SYSINFO_NCPU; i++){
+    busy = cur.cpu[i].busy - prev.cpu[i].busy;
+    idle = cur.cpu[i].idle - prev.cpu[i].idle;
+    if(busy + idle == 0)
+      continue;
+    printf("hart %d: busy ", i);
+    pct(busy, busy + idle);
+    printf(", %d switches\n", (int)(cur.cpu[i].nswitch - prev.cpu[i].nswitch));
+  }
+  printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, secs, count;
+
+  secs = 2;
+  count = -1;
+  for(i = 1; i + 1 < argc; i += 2){
+    if(strcmp(argv[i], "-d") == 0)
+      secs = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-n") == 0)
+      count = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i < argc || secs <= 0 || count == 0){
+    fprintf(2, "usage: top [-d seconds] [-n count]\n");
+    exit(1);
+  }
+
+  get(&prev);
+  while(count < 0 || count-- > 0){
+    nanosleep((uint64)secs * 1000000000);
+    get(&cur);
+    report();
+    prev = cur;
+  }
+  exit(0);
+}
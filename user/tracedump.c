@@ -0,0 +1,122 @@
+// Print the records in the kernel's syscall trace rings,
+// taking them out of the rings, in time order:
+//
+//   $ trace 32 grep hello README
+//   ...
+//   $ tracedump
+//   4: syscall read -> 2226
+//   4: syscall read -> 0
+//
+// -v adds the time, hart, cycle counter and arguments.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/syscall.h"
+#include "kernel/sysname.h"
+#include "kernel/trace.h"
+#include "user/user.h"
+
+#define CHUNK 64
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+struct tracerec *recs, *tmp;
+int nrec, cap;
+
+void
+readall(void)
+{
+  int n;
+
+  for(;;){
+    if(nrec + CHUNK > cap){
+      struct tracerec *r;
+      cap = cap ? 2*cap : 4*CHUNK;
+      if((r = malloc(cap * sizeof(*r))) == 0){
+        fprintf(2, "tracedump: out of memory\n");
+        exit(1);
+      }
+      if(nrec > 0)
+        memmove(r, recs, nrec * sizeof(*r));
+      free(recs);
+      recs = r;
+    }
+    if((n = traceread(recs + nrec, CHUNK)) < 0){
+      fprintf(2, "tracedump: traceread failed\n");
+      exit(1);
+    }
+    if(n == 0)
+      break;
+    nrec += n;
+  }
+}
+
+// merge sort by time; each hart's records
+// arrive already in order.
+void
+sort(int lo, int hi)
+{
+  int mid, i, j, k;
+
+  if(hi - lo < 2)
+    return;
+  mid = (lo + hi) / 2;
+  sort(lo, mid);
+  sort(mid, hi);
+  if(recs[mid-1].time <= recs[mid].time)
+    return;
+  i = lo, j = mid, k = lo;
+  while(i < mid || j < hi){
+    if(j == hi || (i < mid && recs[i].time <= recs[j].time))
+      tmp[k++] = recs[i++];
+    else
+      tmp[k++] = recs[j++];
+  }
+  memmove(recs + lo, tmp + lo, (hi - lo) * sizeof(*recs));
+}
+
+char*
+name(int num)
+{
+  if(num > 0 && num < NELEM(syscall_name) && syscall_name[num])
+    return syscall_name[num];
+  return "?";
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct tracerec *r;
+  int i, verbose;
+
+  verbose = 0;
+  if(argc == 2 && strcmp(argv[1], "-v") == 0)
+    verbose = 1;
+  else if(argc != 1){
+    fprintf(2, "usage: tracedump [-v]\n");
+    exit(1);
+  }
+
+  readall();
+  if(nrec > 0){
+    if((tmp = malloc(nrec * sizeof(*tmp))) == 0){
+      fprintf(2, "tracedump: out of memory\n");
+      exit(1);
+    }
+    sort(0, nrec);
+  }
+
+  for(i = 0; i < nrec; i++){
+    r = &recs[i];
+    if(r->num == 0){
+      printf("hart %d: %l records lost\n", r->cpu, r->ret);
+      continue;
+    }
+    if(verbose)
+      printf("%l %d %l: %d: %s(%p, %p, %p, %p) -> %d\n",
+             r->time, r->cpu, r->cycle, r->pid, name(r->num),
+             r->arg[0], r->arg[1], r->arg[2], r->arg[3], (int)r->ret);
+    else
+      printf("%d: syscall %s -> %d\n", r->pid, name(r->num), (int)r->ret);
+  }
+  exit(0);
+}
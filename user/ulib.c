@@ -8,13 +8,50 @@
 #include "user/user.h"
 
 
+// The string and memory routines work a uint64 at a time
+// wherever the pointers allow, as in kernel/string.c. The
+// str* routines find the terminating NUL (and strchr() its
+// character) in a word at once with the usual has-a-zero-byte
+// test; they read only aligned words, which can't cross into
+// an unmapped page, so they may look past the NUL but never
+// fault.
+
+#define WSIZE sizeof(uint64)
+#define WMASK (WSIZE - 1)
+#define ONES  0x0101010101010101L
+#define HIGHS 0x8080808080808080L
+#define HASZERO(w) (((w) - ONES) & ~(w) & HIGHS)
+
+static uint64
+repeat(int c)
+{
+  uint64 w = (uchar)c;
+
+  w |= w << 8;
+  w |= w << 16;
+  w |= w << 32;
+  return w;
+}
 
 char*
 strcpy(char *s, const char *t)
 {
   char *os;
+  uint64 *ws;
+  const uint64 *wt;
 
   os = s;
+  if((((uint64)s ^ (uint64)t) & WMASK) == 0){
+    while((uint64)t & WMASK)
+      if((*s++ = *t++) == 0)
+        return os;
+    ws = (uint64*)s;
+    wt = (const uint64*)t;
+    while(!HASZERO(*wt))
+      *ws++ = *wt++;
+    s = (char*)ws;
+    t = (const char*)wt;
+  }
   while((*s++ = *t++) != 0)
     ;
   return os;
@@ -23,6 +60,23 @@ strcpy(char *s, const char *t)
 int
 strcmp(const char *p, const char *q)
 {
+  const uint64 *wp, *wq;
+
+  if((((uint64)p ^ (uint64)q) & WMASK) == 0){
+    while((uint64)p & WMASK){
+      if(*p == 0 || *p != *q)
+        return (uchar)*p - (uchar)*q;
+      p++, q++;
+    }
+    // skip equal words without a NUL; the bytes
+    // below find the difference or the end.
+    wp = (const uint64*)p;
+    wq = (const uint64*)q;
+    while(*wp == *wq && !HASZERO(*wp))
+      wp++, wq++;
+    p = (const char*)wp;
+    q = (const char*)wq;
+  }
   while(*p && *p == *q)
     p++, q++;
   return (uchar)*p - (uchar)*q;
@@ -31,33 +85,85 @@ strcmp(const char *p, const char *q)
 uint
 strlen(const char *s)
 {
-  int n;
+  const char *e;
+  const uint64 *w;
 
-  for(n = 0; s[n]; n++)
+  for(e = s; (uint64)e & WMASK; e++)
+    if(*e == 0)
+      return e - s;
+  for(w = (const uint64*)e; !HASZERO(*w); w++)
     ;
-  return n;
+  for(e = (const char*)w; *e; e++)
+    ;
+  return e - s;
 }
 
 void*
 memset(void *dst, int c, uint n)
 {
   char *cdst = (char *) dst;
-  int i;
-  for(i = 0; i < n; i++){
-    cdst[i] = c;
+  uint64 w, *wdst;
+
+  w = repeat(c);
+  while(n > 0 && ((uint64)cdst & WMASK)){
+    *cdst++ = c;
+    n--;
+  }
+  wdst = (uint64*)cdst;
+  for(; n >= 8*WSIZE; n -= 8*WSIZE, wdst += 8){
+    wdst[0] = w; wdst[1] = w; wdst[2] = w; wdst[3] = w;
+    wdst[4] = w; wdst[5] = w; wdst[6] = w; wdst[7] = w;
   }
+  for(; n >= WSIZE; n -= WSIZE)
+    *wdst++ = w;
+  cdst = (char*)wdst;
+  while(n-- > 0)
+    *cdst++ = c;
   return dst;
 }
 
 char*
 strchr(const char *s, char c)
 {
-  for(; *s; s++)
+  const uint64 *w;
+  uint64 cw;
+
+  for(; (uint64)s & WMASK; s++){
+    if(*s == 0)
+      return 0;
+    if(*s == c)
+      return (char*)s;
+  }
+  // stop at the first word holding a NUL or c.
+  cw = repeat(c);
+  for(w = (const uint64*)s; !HASZERO(*w) && !HASZERO(*w ^ cw); w++)
+    ;
+  for(s = (const char*)w; *s; s++)
     if(*s == c)
       return (char*)s;
   return 0;
 }
 
+// the first c in the n bytes at s, or 0.
+void*
+memchr(const void *s, int c, uint n)
+{
+  const uchar *p = s;
+  const uint64 *w;
+  uint64 cw;
+
+  for(; n > 0 && ((uint64)p & WMASK); p++, n--)
+    if(*p == (uchar)c)
+      return (void*)p;
+  cw = repeat(c);
+  for(w = (const uint64*)p; n >= WSIZE && !HASZERO(*w ^ cw); w++)
+    n -= WSIZE;
+  for(p = (const uchar*)w; n > 0; p++, n--)
+    if(*p == (uchar)c)
+      return (void*)p;
+  return 0;
+}
+
 char*
 gets(char *buf, int max)
 {
@@ -104,33 +210,82 @@ atoi(const char *s)
 void*
 memmove(void *vdst, const void *vsrc, int n)
 {
-  char *dst;
-  const char *src;
+  const char *s;
+  char *d;
+  const uint64 *ws;
+  uint64 *wd;
+  int words;
+
+  if(n <= 0)
+    return vdst;
 
-  dst = vdst;
-  src = vsrc;
-  if (src > dst) {
+  s = vsrc;
+  d = vdst;
+  // copy words only if s and d can both be aligned.
+  words = (((uint64)s ^ (uint64)d) & WMASK) == 0;
+  if(s < d && s + n > d){
+    s += n;
+    d += n;
+    if(words){
+      while(n > 0 && ((uint64)d & WMASK)){
+        *--d = *--s;
+        n--;
+      }
+      ws = (const uint64*)s;
+      wd = (uint64*)d;
+      for(; n >= WSIZE; n -= WSIZE)
+        *--wd = *--ws;
+      s = (const char*)ws;
+      d = (char*)wd;
+    }
     while(n-- > 0)
-      *dst++ = *src++;
+      *--d = *--s;
   } else {
-    dst += n;
-    src += n;
+    if(words){
+      while(n > 0 && ((uint64)d & WMASK)){
+        *d++ = *s++;
+        n--;
+      }
+      ws = (const uint64*)s;
+      wd = (uint64*)d;
+      for(; n >= 8*WSIZE; n -= 8*WSIZE, wd += 8, ws += 8){
+        uint64 a0 = ws[0], a1 = ws[1], a2 = ws[2], a3 = ws[3];
+        uint64 a4 = ws[4], a5 = ws[5], a6 = ws[6], a7 = ws[7];
+        wd[0] = a0; wd[1] = a1; wd[2] = a2; wd[3] = a3;
+        wd[4] = a4; wd[5] = a5; wd[6] = a6; wd[7] = a7;
+      }
+      for(; n >= WSIZE; n -= WSIZE)
+        *wd++ = *ws++;
+      s = (const char*)ws;
+      d = (char*)wd;
+    }
     while(n-- > 0)
-      *--dst = *--src;
+      *d++ = *s++;
   }
   return vdst;
 }
 
 int
-memcmp(const void *s1, const void *s2, uint n)
+memcmp(const void *v1, const void *v2, uint n)
 {
-  const char *p1 = s1, *p2 = s2;
-  while (n-- > 0) {
-    if (*p1 != *p2) {
-      return *p1 - *p2;
+  const uchar *s1, *s2;
+
+  s1 = v1;
+  s2 = v2;
+  if((((uint64)s1 ^ (uint64)s2) & WMASK) == 0){
+    while(n > 0 && ((uint64)s1 & WMASK)){
+      if(*s1 != *s2)
+        return *s1 - *s2;
+      s1++, s2++, n--;
     }
-    p1++;
-    p2++;
+    // skip equal words; the bytes below find the difference.
+    while(n >= WSIZE && *(uint64*)s1 == *(uint64*)s2)
+      s1 += WSIZE, s2 += WSIZE, n -= WSIZE;
+  }
+  while(n-- > 0){
+    if(*s1 != *s2)
+      return *s1 - *s2;
+    s1++, s2++;
   }
   return 0;
 }
@@ -141,6 +296,13 @@ memcpy(void *dst, const void *src, uint n)
   return memmove(dst, src, n);
 }
 
+// n events in t nanoseconds, as in clock_gettime(), per second.
+uint64
+persec(uint64 n, uint64 t)
+{
+  return t ? n * 1000000000 / t : 0;
+}
+
 #ifdef LAB_PGTBL
 int
 ugetpid(void)
@@ -148,4 +310,54 @@ ugetpid(void)
   struct usyscall *u = (struct usyscall *)USYSCALL;
   return u->pid;
 }
+
+// getpid(), uptime() and clock_gettime() without a trap;
+// see VDATA in kernel/memlayout.h.
+int sys_getpid(void);
+int sys_uptime(void);
+int sys_clock_gettime(uint64*);
+
+int
+getpid(void)
+{
+  return ((struct usyscall *)USYSCALL)->pid;
+}
+
+// the hart this process last ran on.
+int
+getcpu(void)
+{
+  return ((struct usyscall *)USYSCALL)->cpu;
+}
+
+int
+uptime(void)
+{
+  volatile struct vdata *vd = (struct vdata *)VDATA;
+  uint64 ticks, stamp, period;
+  uint seq;
+
+  if(vd->version != VDATA_VERSION)
+    return sys_uptime();
+  do {
+    seq = vd->seq;
+    __sync_synchronize();
+    ticks = vd->ticks;
+    stamp = vd->stamp;
+    period = vd->tickcycles;
+    __sync_synchronize();
+  } while((seq & 1) || seq != vd->seq);
+  return ticks + (r_time() - stamp) / period;
+}
+
+int
+clock_gettime(uint64 *ns)
+{
+  volatile struct vdata *vd = (struct vdata *)VDATA;
+
+  if(vd->version != VDATA_VERSION)
+    return sys_clock_gettime(ns);
+  *ns = (r_time() - vd->timebase) * (1000000000L / vd->timefreq);
+  return 0;
+}
 #endif
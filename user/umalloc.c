@@ -3,88 +3,448 @@
 #include "user/user.h"
 #include "kernel/param.h"
 
-// Memory allocator by Kernighan and Ritchie,
-// The C programming Language, 2nd ed.  Section 8.7.
+// Memory allocator.
+//
+// Requests of up to MAXSMALL bytes come from slabs: SLABSIZE
+// pieces of the heap cut into objects of one size class. Each
+// object is preceded by a tag word pointing at its slab, and
+// each slab keeps a list of its freed objects and cuts new ones
+// off its unused end, so malloc() and free() of small objects
+// are O(1). Each class keeps one empty slab for reuse and
+// gives any others back to the heap.
+//
+// Larger requests, and the slabs themselves, are blocks with
+// boundary tags, after Doug Lea's malloc: each block's header
+// holds its size, whether it is in use, and whether the block
+// before it is; the header of the block after a free block
+// holds the free block's size too. So free() merges a block
+// with free neighbours in O(1). Free blocks live in bins by
+// size, four to each power of two, and malloc() takes the best
+// fit out of the first bin that can satisfy the request.
+//
+// When the free block at the top of the heap grows past TRIM
+// bytes, free() gives all but KEEP of it back with sbrk(-n),
+// first freeing any kept empty slab that stands in the way.
+//
+// One mutex guards the heap, so threads can share it.
 
-typedef long Align;
+typedef struct block {
+  uint64 prevsize;           // size of the block before, if it is free
+  uint64 size;               // size of this block, with the flags below
+  struct block *next, *prev; // in a bin, if free
+} Block;
 
-union header {
-  struct {
-    union header *ptr;
-    uint size;
-  } s;
-  Align x;
+#define INUSE   1
+#define PINUSE  2            // the block before is in use
+#define SLABTAG 4            // in a slab object's tag word
+#define FLAGS   7
+
+#define HDR 16               // prevsize and size; the caller's bytes follow
+#define MINBLOCK sizeof(Block)
+#define SIZE(b) ((b)->size & ~FLAGS)
+#define NEXT(b) ((Block*)((char*)(b) + SIZE(b)))
+#define PREV(b) ((Block*)((char*)(b) - (b)->prevsize))
+
+#define NBIN 128
+#define PAGE 4096
+#define GROW (64*1024)       // least heap to ask sbrk() for
+#define TRIM (128*1024)
+#define KEEP (64*1024)
+
+struct slab {
+  struct slab *next, *prev;  // in heap.partial[cls], if it has free objects
+  uint64 *free;              // free objects' tag words, each holding the next
+  ushort nfree;
+  ushort nobj;
+  ushort ncut;               // objects handed out at least once
+  uchar cls;
 };
 
-typedef union header Header;
+#define SLABSIZE 4096        // bytes of heap per slab, header included
+#define NCLASS 16
+#define MAXSMALL (512 - 8)   // largest class less its tag word
 
-static Header base;
-static Header *freep;
+static ushort classsize[NCLASS] = {
+  16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
 
-void
-free(void *ap)
+static struct {
+  struct mutex lock;
+  int ready;
+  uchar sizeclass[512/16 + 1];     // class for each multiple of 16 bytes
+  struct slab *partial[NCLASS];
+  struct slab *empty[NCLASS];      // an empty slab kept in partial[]
+  Block *bin[NBIN];
+  uint64 binmap[NBIN/64];          // which bins are non-empty
+  char *end;                       // end of the last sbrk()
+  Block *fence;                    // in-use header at the top of the heap
+} heap;
+
+static void
+setup(void)
+{
+  int i, c;
+
+  c = 0;
+  for(i = 0; i < sizeof(heap.sizeclass); i++){
+    while(classsize[c] < i * 16)
+      c++;
+    heap.sizeclass[i] = c;
+  }
+  heap.ready = 1;
+}
+
+static int
+binof(uint64 size)
+{
+  int b;
+
+  for(b = 5; (size >> (b+1)) != 0; b++)
+    ;
+  return (b - 5) * 4 + ((size >> (b - 2)) & 3);
+}
+
+static void
+bin(Block *b)
+{
+  int i = binof(SIZE(b));
+
+  b->prev = 0;
+  b->next = heap.bin[i];
+  if(b->next)
+    b->next->prev = b;
+  heap.bin[i] = b;
+  heap.binmap[i/64] |= 1L << (i%64);
+}
+
+static void
+unbin(Block *b)
+{
+  int i = binof(SIZE(b));
+
+  if(b->prev)
+    b->prev->next = b->next;
+  else
+    heap.bin[i] = b->next;
+  if(b->next)
+    b->next->prev = b->prev;
+  if(heap.bin[i] == 0)
+    heap.binmap[i/64] &= ~(1L << (i%64));
+}
+
+// the first non-empty bin from i on, or -1.
+static int
+nextbin(int i)
+{
+  uint64 m;
+
+  for(; i < NBIN; i = (i/64 + 1) * 64){
+    m = heap.binmap[i/64] >> (i%64);
+    if(m == 0)
+      continue;
+    while((m & 1) == 0){
+      m >>= 1;
+      i++;
+    }
+    return i;
+  }
+  return -1;
+}
+
+// take the smallest free block of at least n bytes out of
+// its bin. Blocks in the bin for n may be smaller than n;
+// any block in a later bin will do.
+static Block*
+bestfit(uint64 n)
+{
+  Block *b, *best;
+  int i;
+
+  best = 0;
+  i = binof(n);
+  for(b = heap.bin[i]; b; b = b->next)
+    if(SIZE(b) >= n && (best == 0 || SIZE(b) < SIZE(best)))
+      best = b;
+  if(best == 0){
+    if((i = nextbin(i + 1)) < 0)
+      return 0;
+    for(b = heap.bin[i]; b; b = b->next)
+      if(best == 0 || SIZE(b) < SIZE(best))
+        best = b;
+  }
+  unbin(best);
+  return best;
+}
+
+// b has just become free: merge it with free neighbours,
+// and return the result (not yet in a bin).
+static Block*
+coalesce(Block *b)
+{
+  Block *n;
+
+  b->size &= ~INUSE;
+  if((b->size & PINUSE) == 0){
+    n = PREV(b);
+    unbin(n);
+    n->size += SIZE(b);
+    b = n;
+  }
+  n = NEXT(b);
+  if((n->size & INUSE) == 0){
+    unbin(n);
+    b->size += SIZE(n);
+  }
+  n = NEXT(b);
+  n->prevsize = SIZE(b);
+  n->size &= ~PINUSE;
+  return b;
+}
+
+// mark free block b in use, giving any of it beyond
+// the first n bytes back to a bin.
+static void
+split(Block *b, uint64 n)
+{
+  uint64 rest = SIZE(b) - n;
+  Block *r;
+
+  if(rest >= MINBLOCK){
+    b->size = n | (b->size & PINUSE) | INUSE;
+    r = NEXT(b);
+    r->size = rest | PINUSE;
+    NEXT(r)->prevsize = rest;
+    bin(r);
+  } else {
+    b->size |= INUSE;
+    NEXT(b)->size |= PINUSE;
+  }
+}
+
+// get heap from the kernel for a block of at least n bytes,
+// and put it in a bin. If it follows on from the last heap
+// the old fence becomes the new block's header; otherwise
+// (someone else called sbrk()) it starts a new segment.
+static int
+morecore(uint64 n)
+{
+  char *p, *end;
+  Block *b;
+
+  n += 2 * HDR;
+  if(n < GROW)
+    n = GROW;
+  n = (n + PAGE - 1) & ~(PAGE - 1);
+  if(n > 0x7fffffff || (p = sbrk(n)) == (char*)-1)
+    return -1;
+  end = (char*)(((uint64)p + n) & ~15L);
+  if(p == heap.end && heap.fence){
+    b = heap.fence;
+    b->size = (end - HDR - (char*)b) | (b->size & PINUSE) | INUSE;
+  } else {
+    b = (Block*)(((uint64)p + 15) & ~15L);
+    b->size = (end - HDR - (char*)b) | PINUSE | INUSE;
+  }
+  heap.end = p + n;
+  heap.fence = (Block*)(end - HDR);
+  heap.fence->size = INUSE;
+  bin(coalesce(b));
+  return 0;
+}
+
+// if b, a free block not in a bin, is at the top of the
+// heap and big, give most of it back to the kernel.
+// returns 1 if it did.
+static int
+trim(Block *b)
 {
-  Header *bp, *p;
-
-  bp = (Header*)ap - 1;
-  for(p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
-    if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
-      break;
-  if(bp + bp->s.size == p->s.ptr){
-    bp->s.size += p->s.ptr->s.size;
-    bp->s.ptr = p->s.ptr->s.ptr;
-  } else
-    bp->s.ptr = p->s.ptr;
-  if(p + p->s.size == bp){
-    p->s.size += bp->s.size;
-    p->s.ptr = bp->s.ptr;
-  } else
-    p->s.ptr = bp;
-  freep = p;
-}
-
-static Header*
-morecore(uint nu)
-{
-  char *p;
-  Header *hp;
-
-  if(nu < 4096)
-    nu = 4096;
-  p = sbrk(nu * sizeof(Header));
-  if(p == (char*)-1)
+  uint64 n;
+
+  if(NEXT(b) != heap.fence || SIZE(b) < TRIM || sbrk(0) != heap.end)
+    return 0;
+  n = (SIZE(b) - KEEP) & ~(PAGE - 1);
+  if(sbrk(-n) == (char*)-1)
     return 0;
-  hp = (Header*)p;
-  hp->s.size = nu;
-  free((void*)(hp + 1));
-  return freep;
+  heap.end -= n;
+  heap.fence = (Block*)((((uint64)heap.end) & ~15L) - HDR);
+  heap.fence->size = INUSE;
+  heap.fence->prevsize = (char*)heap.fence - (char*)b;
+  b->size = heap.fence->prevsize | PINUSE;
+  return 1;
 }
 
-void*
-malloc(uint nbytes)
+// n is a block size, header included.
+static void*
+bigalloc(uint64 n)
 {
-  Header *p, *prevp;
-  uint nunits;
+  Block *b;
 
-  nunits = (nbytes + sizeof(Header) - 1)/sizeof(Header) + 1;
-  if((prevp = freep) == 0){
-    base.s.ptr = freep = prevp = &base;
-    base.s.size = 0;
+  while((b = bestfit(n)) == 0)
+    if(morecore(n) < 0)
+      return 0;
+  split(b, n);
+  return (char*)b + HDR;
+}
+
+static void unpartial(struct slab*);
+
+// does slab block s keep trim() from giving memory back? it
+// does if it is just below a free block at the top of the
+// heap, and either sits between free blocks or would make
+// that block big enough to trim.
+static int
+pins(Block *s)
+{
+  Block *b = NEXT(s);
+
+  if((b->size & INUSE) || NEXT(b) != heap.fence)
+    return 0;
+  return (s->size & PINUSE) == 0 || SIZE(b) + SIZE(s) >= TRIM;
+}
+
+// if *bp, a free block not in a bin, is at the top of the
+// heap and a kept empty slab pins it, free the slab; *bp
+// becomes the merged block. returns 1 if it freed a slab.
+static int
+unpin(Block **bp)
+{
+  Block *s;
+  int c;
+
+  for(c = 0; c < NCLASS; c++){
+    if(heap.empty[c] == 0)
+      continue;
+    s = (Block*)((char*)heap.empty[c] - HDR);
+    if(NEXT(s) != *bp || !pins(s))
+      continue;
+    unpartial(heap.empty[c]);
+    heap.empty[c] = 0;
+    bin(*bp);
+    *bp = coalesce(s);
+    return 1;
   }
-  for(p = prevp->s.ptr; ; prevp = p, p = p->s.ptr){
-    if(p->s.size >= nunits){
-      if(p->s.size == nunits)
-        prevp->s.ptr = p->s.ptr;
-      else {
-        p->s.size -= nunits;
-        p += p->s.size;
-        p->s.size = nunits;
-      }
-      freep = prevp;
-      return (void*)(p + 1);
+  return 0;
+}
+
+static void
+bigfree(Block *b)
+{
+  b = coalesce(b);
+  while(trim(b) || unpin(&b))
+    ;
+  bin(b);
+}
+
+static struct slab*
+newslab(int c)
+{
+  struct slab *s;
+
+  if((s = bigalloc(SLABSIZE)) == 0)
+    return 0;
+  s->cls = c;
+  s->nobj = (SLABSIZE - HDR - sizeof(*s) - 8) / classsize[c];
+  s->nfree = s->nobj;
+  s->ncut = 0;
+  s->free = 0;
+  s->prev = 0;
+  s->next = heap.partial[c];
+  if(s->next)
+    s->next->prev = s;
+  heap.partial[c] = s;
+  return s;
+}
+
+static void
+unpartial(struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    heap.partial[s->cls] = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+static void*
+smallalloc(int c)
+{
+  struct slab *s;
+  uint64 *t;
+
+  if((s = heap.partial[c]) == 0 && (s = newslab(c)) == 0)
+    return 0;
+  if(s == heap.empty[c])
+    heap.empty[c] = 0;
+  if((t = s->free) != 0){
+    s->free = (uint64*)*t;
+  } else {
+    // tag words sit 8 bytes before each object,
+    // which is 16-byte aligned.
+    t = (uint64*)((char*)(s + 1) + 8 + s->ncut * classsize[c]);
+    s->ncut++;
+  }
+  *t = (uint64)s | SLABTAG;
+  if(--s->nfree == 0)
+    unpartial(s);
+  return t + 1;
+}
+
+// t is the object's tag word. An empty slab is kept if its
+// class has none, so that allocating and freeing one object
+// over and over doesn't make and break a slab each time;
+// any other, or one that pins the top of the heap, goes back
+// to the heap.
+static void
+smallfree(struct slab *s, uint64 *t)
+{
+  *t = (uint64)s->free;
+  s->free = t;
+  if(s->nfree++ == 0){
+    s->prev = 0;
+    s->next = heap.partial[s->cls];
+    if(s->next)
+      s->next->prev = s;
+    heap.partial[s->cls] = s;
+  }
+  if(s->nfree == s->nobj){
+    if(heap.empty[s->cls] == 0 && !pins((Block*)((char*)s - HDR))){
+      heap.empty[s->cls] = s;
+      return;
     }
-    if(p == freep)
-      if((p = morecore(nunits)) == 0)
-        return 0;
+    unpartial(s);
+    bigfree((Block*)((char*)s - HDR));
   }
 }
+
+void
+free(void *ap)
+{
+  uint64 tag;
+
+  if(ap == 0)
+    return;
+  mutex_lock(&heap.lock);
+  tag = ((uint64*)ap)[-1];
+  if(tag & SLABTAG)
+    smallfree((struct slab*)(tag & ~FLAGS), (uint64*)ap - 1);
+  else
+    bigfree((Block*)((char*)ap - HDR));
+  mutex_unlock(&heap.lock);
+}
+
+void*
+malloc(uint nbytes)
+{
+  void *p;
+
+  mutex_lock(&heap.lock);
+  if(!heap.ready)
+    setup();
+  if(nbytes <= MAXSMALL)
+    p = smallalloc(heap.sizeclass[(nbytes + 8 + 15) / 16]);
+  else
+    p = bigalloc(((uint64)nbytes + HDR + 15) & ~15L);
+  mutex_unlock(&heap.lock);
+  return p;
+}
@@ -1,6 +1,11 @@
 struct stat;
 struct rtcdate;
 struct sysinfo;
+struct tracerec;
+struct sysstat;
+struct profsample;
+struct tdirent;
+struct direntplus;
 
 // system calls
 int fork(void);
@@ -20,12 +25,29 @@ int link(const char*, const char*);
 int mkdir(const char*);
 int chdir(const char*);
 int dup(int);
+// With LAB_PGTBL, getpid() reads the USYSCALL page, which
+// in a thread holds the group leader's pid; sys_getpid()
+// traps and returns the thread's own id.
 int getpid(void);
 char* sbrk(int);
 int sleep(int);
 int uptime(void);
 int trace(int);
 int sysinfo(struct sysinfo *);
+int spawn(char*, char**, int*);
+int clone(void (*)(void*), void*, void*);
+int futex_wait(volatile int*, int);
+int futex_wake(volatile int*, int);
+int nanosleep(uint64);
+int clock_gettime(uint64*);
+int traceread(struct tracerec*, int);
+int sysstat(int, int, struct sysstat*);
+int prof(int);
+int profread(struct profsample*, int);
+int getdents(int, struct tdirent*, int);
+int readdirplus(int, struct direntplus*, int);
+int pipe2(int*, int);
+int sysinfo2(struct sysinfo*, int);
 #ifdef LAB_NET
 int connect(uint32, uint16, uint16);
 #endif
@@ -33,6 +55,8 @@ int connect(uint32, uint16, uint16);
 int pgaccess(void *base, int len, void *mask);
 // usyscall region
 int ugetpid(void);
+int getcpu(void);
+int sys_getpid(void);
 #endif
 
 // ulib.c
@@ -41,8 +65,6 @@ char* strcpy(char*, const char*);
 void *memmove(void*, const void*, int);
 char* strchr(const char*, char c);
 int strcmp(const char*, const char*);
-void fprintf(int, const char*, ...);
-void printf(const char*, ...);
 char* gets(char*, int max);
 uint strlen(const char*);
 void* memset(void*, int, uint);
@@ -50,5 +72,56 @@ void* malloc(uint);
 void free(void*);
 int atoi(const char*);
 int memcmp(const void *, const void *, uint);
+void* memchr(const void*, int, uint);
 void *memcpy(void *, const void *, uint);
+uint64 persec(uint64, uint64);
 int statistics(void*, int);
+
+// thread.c
+struct mutex {
+  volatile int v;
+};
+struct cond {
+  volatile int seq;
+};
+int thread_create(void (*)(void*), void*);
+int thread_join(int);
+void mutex_init(struct mutex*);
+void mutex_lock(struct mutex*);
+void mutex_unlock(struct mutex*);
+void cond_init(struct cond*);
+void cond_wait(struct cond*, struct mutex*);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
+
+// stdio.c
+#define BUFSIZ 512
+#define _IONBF 0  // flush at the end of each call
+#define _IOLBF 1  // flush at each newline
+#define _IOFBF 2  // flush when the buffer fills
+typedef struct FILE {
+  int fd;
+  int mode;
+  int n;                // bytes in buf
+  volatile int lock;
+  struct FILE *next;
+  char buf[BUFSIZ];
+} FILE;
+extern FILE *stdout, *stderr;
+FILE* fdopen(int, char*);
+int fclose(FILE*);
+int fflush(FILE*);
+int setvbuf(FILE*, int);
+int fputc(int, FILE*);
+int fputs(const char*, FILE*);
+int fwrite(const void*, uint, uint, FILE*);
+void finit(FILE*, int, int);
+void flock(FILE*);
+void funlock(FILE*);
+void putch(FILE*, int);
+void fendcall(FILE*);
+
+// printf.c
+void fprintf(int, const char*, ...);
+void printf(const char*, ...);
+void fileprintf(FILE*, const char*, ...);
@@ -5,6 +5,8 @@
 #include "kernel/fs.h"
 #include "kernel/fcntl.h"
 #include "kernel/syscall.h"
+#include "kernel/sysstat.h"
+#include "kernel/sysinfo.h"
 #include "kernel/memlayout.h"
 #include "kernel/riscv.h"
 
@@ -669,6 +671,187 @@ void dirtest(char *s)
   }
 }
 
+// readdirplus() returns every entry once, with the right
+// types and sizes, a few at a time.
+void
+readdirplustest(char *s)
+{
+  struct direntplus de[3];
+  char name[DIRSIZ+1], buf[128];
+  int fd, i, n, seen, dots;
+
+  if(mkdir("rdpdir") < 0 || chdir("rdpdir") < 0){
+    printf("%s: mkdir rdpdir failed\n", s);
+    exit(1);
+  }
+  memset(buf, 'x', sizeof(buf));
+  name[0] = 'f';
+  name[2] = 0;
+  for(i = 0; i < 5; i++){
+    name[1] = '0' + i;
+    if((fd = open(name, O_CREATE|O_WRONLY)) < 0 || write(fd, buf, i * 20) != i * 20){
+      printf("%s: create %s failed\n", s, name);
+      exit(1);
+    }
+    close(fd);
+  }
+  if(mkdir("sub") < 0){
+    printf("%s: mkdir sub failed\n", s);
+    exit(1);
+  }
+
+  if((fd = open(".", 0)) < 0){
+    printf("%s: open . failed\n", s);
+    exit(1);
+  }
+  seen = dots = 0;
+  while((n = readdirplus(fd, de, sizeof(de))) > 0){
+    if(n % sizeof(de[0]) != 0){
+      printf("%s: readdirplus returned %d\n", s, n);
+      exit(1);
+    }
+    for(i = 0; i < n / sizeof(de[0]); i++){
+      memmove(name, de[i].name, DIRSIZ);
+      name[DIRSIZ] = 0;
+      if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strcmp(name, "sub") == 0){
+        if(de[i].type != T_DIR){
+          printf("%s: %s has type %d\n", s, name, de[i].type);
+          exit(1);
+        }
+        dots++;
+      } else if(name[0] == 'f' && name[1] >= '0' && name[1] < '5' && name[2] == 0){
+        if(de[i].type != T_FILE || de[i].size != (name[1] - '0') * 20){
+          printf("%s: %s has type %d size %d\n", s, name, de[i].type, de[i].size);
+          exit(1);
+        }
+        if(seen & (1 << (name[1] - '0'))){
+          printf("%s: %s twice\n", s, name);
+          exit(1);
+        }
+        seen |= 1 << (name[1] - '0');
+      } else {
+        printf("%s: unexpected entry %s\n", s, name);
+        exit(1);
+      }
+    }
+  }
+  close(fd);
+  if(n < 0 || seen != 0x1f || dots != 3){
+    printf("%s: readdirplus missed entries\n", s);
+    exit(1);
+  }
+
+  if((fd = open("f1", 0)) < 0 || readdirplus(fd, de, sizeof(de)) != -1){
+    printf("%s: readdirplus of a file succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  name[0] = 'f';
+  name[2] = 0;
+  for(i = 0; i < 5; i++){
+    name[1] = '0' + i;
+    unlink(name);
+  }
+  unlink("sub");
+  if(chdir("..") < 0 || unlink("rdpdir") < 0){
+    printf("%s: unlink rdpdir failed\n", s);
+    exit(1);
+  }
+}
+
+// readdirplus() while another process creates and unlinks
+// entries in the same directory.
+void
+readdirplusrace(char *s)
+{
+  struct direntplus de[4];
+  char name[3];
+  int fd, i, n, pid, round, xstatus;
+
+  if(mkdir("rdprace") < 0 || chdir("rdprace") < 0){
+    printf("%s: mkdir rdprace failed\n", s);
+    exit(1);
+  }
+  name[0] = 'f';
+  name[2] = 0;
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(round = 0; round < 100; round++){
+      for(i = 0; i < 10; i++){
+        name[1] = '0' + i;
+        if((fd = open(name, O_CREATE|O_WRONLY)) < 0){
+          printf("%s: create %s failed\n", s, name);
+          exit(1);
+        }
+        write(fd, name, round % 3);
+        close(fd);
+      }
+      for(i = 0; i < 10; i++){
+        name[1] = '0' + i;
+        unlink(name);
+      }
+    }
+    exit(0);
+  }
+
+  for(round = 0; round < 200; round++){
+    if((fd = open(".", 0)) < 0){
+      printf("%s: open . failed\n", s);
+      exit(1);
+    }
+    while((n = readdirplus(fd, de, sizeof(de))) > 0){
+      for(i = 0; i < n / sizeof(de[0]); i++){
+        if(de[i].type != T_FILE && de[i].type != T_DIR){
+          printf("%s: entry with type %d\n", s, de[i].type);
+          exit(1);
+        }
+      }
+    }
+    close(fd);
+    if(n < 0){
+      printf("%s: readdirplus failed\n", s);
+      exit(1);
+    }
+  }
+  wait(&xstatus);
+  if(xstatus != 0)
+    exit(xstatus);
+
+  for(i = 0; i < 10; i++){
+    name[1] = '0' + i;
+    unlink(name);
+  }
+  if(chdir("..") < 0 || unlink("rdprace") < 0){
+    printf("%s: unlink rdprace failed\n", s);
+    exit(1);
+  }
+}
+
+// a running program's file can't be written or truncated,
+// since its pages are read in as they are touched.
+void
+textbusy(char *s)
+{
+  int fd;
+
+  if((fd = open("usertests", O_RDONLY)) < 0){
+    printf("%s: open usertests failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  if((fd = open("usertests", O_WRONLY)) >= 0 ||
+     (fd = open("usertests", O_RDWR)) >= 0 ||
+     (fd = open("usertests", O_RDONLY|O_TRUNC)) >= 0){
+    printf("%s: opened the running usertests for writing\n", s);
+    exit(1);
+  }
+}
+
 void
 exectest(char *s)
 {
@@ -780,6 +963,51 @@ pipe1(char *s)
 }
 
 
+// a pipe2() pipe holds what was asked for, and keeps
+// bytes in order across its pages and as it wraps.
+void
+pipe2test(char *s)
+{
+  int fds[2], i, n, cc, round, wseq, rseq;
+  enum { SZ=20000 };
+
+  if(pipe2(fds, 1024*1024) != -1){
+    printf("%s: pipe2() of 1MB succeeded\n", s);
+    exit(1);
+  }
+  if(pipe2(fds, SZ) != 0){
+    printf("%s: pipe2() failed\n", s);
+    exit(1);
+  }
+  wseq = rseq = 0;
+  for(round = 0; round < 5; round++){
+    // no reader is running, so the whole of SZ must fit.
+    for(n = 0; n < SZ; n += cc){
+      cc = SZ - n < 1033 ? SZ - n : 1033;
+      for(i = 0; i < cc; i++)
+        buf[i] = wseq++;
+      if(write(fds[1], buf, cc) != cc){
+        printf("%s: pipe2 write failed\n", s);
+        exit(1);
+      }
+    }
+    for(n = 0; n < SZ; n += cc){
+      if((cc = read(fds[0], buf, 777 + round)) <= 0){
+        printf("%s: pipe2 read failed\n", s);
+        exit(1);
+      }
+      for(i = 0; i < cc; i++){
+        if((buf[i] & 0xff) != (rseq++ & 0xff)){
+          printf("%s: pipe2 read wrong data\n", s);
+          exit(1);
+        }
+      }
+    }
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
 // test if child is killed (status = -1)
 void
 killstatus(char *s)
@@ -1080,6 +1308,44 @@ mem(char *s)
   }
 }
 
+// malloc() hands out aligned, disjoint blocks, and gives
+// the heap back to the kernel once they are freed.
+void
+malloctest(char *s)
+{
+  enum { N = 400 };
+  static char *p[N];
+  char *brk0;
+  int i, j, n;
+
+  brk0 = sbrk(0);
+  for(j = 0; j < 2; j++){
+    for(i = 0; i < N; i++){
+      n = (i % 4 == 0) ? 1000 * i : i;
+      if((p[i] = malloc(n + 1)) == 0 || ((uint64)p[i] & 15) != 0){
+        printf("%s: malloc(%d) returned %p\n", s, n + 1, p[i]);
+        exit(1);
+      }
+      memset(p[i], i, n + 1);
+    }
+    for(i = 0; i < N; i++){
+      n = (i % 4 == 0) ? 1000 * i : i;
+      if(p[i][0] != (char)i || p[i][n] != (char)i){
+        printf("%s: block %d overwritten\n", s, i);
+        exit(1);
+      }
+    }
+    for(i = j; i < N; i += 2)
+      free(p[i]);
+    for(i = 1 - j; i < N; i += 2)
+      free(p[i]);
+  }
+  if(sbrk(0) - brk0 > 256*1024){
+    printf("%s: heap grew by %d bytes\n", s, (int)(sbrk(0) - brk0));
+    exit(1);
+  }
+}
+
 // More file system tests
 
 // two processes write to the same file descriptor
@@ -2381,6 +2647,356 @@ bsstest(char *s)
   }
 }
 
+// exec() maps program pages lazily. do system calls that copy
+// into and out of data pages nobody has touched yet (some with
+// kernel locks held) page them in with the right contents?
+char lazydata[3*PGSIZE] = { 'l', 'a', 'z', 'y' };
+void
+lazycopy(char *s)
+{
+  int fd, fds[2];
+  char c;
+
+  fd = open("README", 0);
+  if(fd < 0){
+    printf("%s: cannot open README\n", s);
+    exit(1);
+  }
+  if(read(fd, lazydata + PGSIZE, 64) != 64){
+    printf("%s: read into lazy page failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  if(lazydata[PGSIZE] != 'x' || memcmp(lazydata, "lazy", 4) != 0){
+    printf("%s: lazy page has wrong contents\n", s);
+    exit(1);
+  }
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe() failed\n", s);
+    exit(1);
+  }
+  if(write(fds[1], lazydata + 2*PGSIZE + 1, 1) != 1){
+    printf("%s: write from lazy page failed\n", s);
+    exit(1);
+  }
+  c = 1;
+  if(read(fds[0], &c, 1) != 1 || c != 0){
+    printf("%s: lazy page not zero\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+volatile int cloneval;
+int clonefds[2];
+
+void
+clonechild(void *arg)
+{
+  cloneval = (int)(uint64)arg;
+  if(pipe(clonefds) < 0)
+    cloneval = -1;
+  exit(0);
+}
+
+void
+clonespin(void *arg)
+{
+  for(;;)
+    ;
+}
+
+// a clone()d thread shares memory and file descriptors with
+// its creator, is reaped by wait(), and dies with its group.
+void
+clonetest(char *s)
+{
+  int tid, pid, xstatus;
+
+  tid = thread_create(clonechild, (void*)7);
+  if(tid < 0){
+    printf("%s: thread_create failed\n", s);
+    exit(1);
+  }
+  if(thread_join(tid) < 0){
+    printf("%s: thread_join failed\n", s);
+    exit(1);
+  }
+  if(cloneval != 7){
+    printf("%s: thread's write not seen\n", s);
+    exit(1);
+  }
+  if(close(clonefds[0]) < 0 || close(clonefds[1]) < 0){
+    printf("%s: thread's fds not shared\n", s);
+    exit(1);
+  }
+
+  // the leader exits while its thread is still running.
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    if(thread_create(clonespin, 0) < 0)
+      exit(1);
+    exit(0);
+  }
+  if(wait(&xstatus) != pid || xstatus != 0){
+    printf("%s: group with a running thread didn't exit\n", s);
+    exit(1);
+  }
+}
+
+volatile int futexword;
+struct mutex futexmu;
+int futexcount;
+
+void
+futexwaiter(void *arg)
+{
+  while(futexword == 0)
+    futex_wait(&futexword, 0);
+  for(int i = 0; i < 1000; i++){
+    mutex_lock(&futexmu);
+    futexcount++;
+    mutex_unlock(&futexmu);
+  }
+  exit(0);
+}
+
+// threads block in futex_wait() until woken, and a
+// futex mutex keeps their counter updates apart.
+void
+futextest(char *s)
+{
+  int i, tid[4];
+
+  if(futex_wait(&futexword, 1) != -1){
+    printf("%s: futex_wait with a stale value slept\n", s);
+    exit(1);
+  }
+  if(futex_wake(&futexword, 1) != 0){
+    printf("%s: futex_wake woke a non-waiter\n", s);
+    exit(1);
+  }
+
+  mutex_init(&futexmu);
+  for(i = 0; i < 4; i++){
+    if((tid[i] = thread_create(futexwaiter, 0)) < 0){
+      printf("%s: thread_create failed\n", s);
+      exit(1);
+    }
+  }
+  sleep(1);
+  futexword = 1;
+  futex_wake(&futexword, 4);
+  for(i = 0; i < 4; i++)
+    thread_join(tid[i]);
+  if(futexcount != 4000){
+    printf("%s: count %d, want 4000\n", s, futexcount);
+    exit(1);
+  }
+}
+
+// nanosleep() sleeps at least as long as asked, and
+// clock_gettime() moves forward with it.
+void
+nanosleeptest(char *s)
+{
+  uint64 t0, t1;
+
+  if(clock_gettime(&t0) < 0){
+    printf("%s: clock_gettime failed\n", s);
+    exit(1);
+  }
+  if(nanosleep(30 * 1000 * 1000) < 0){
+    printf("%s: nanosleep failed\n", s);
+    exit(1);
+  }
+  clock_gettime(&t1);
+  if(t1 - t0 < 30 * 1000 * 1000){
+    printf("%s: slept only %d ns\n", s, (int)(t1 - t0));
+    exit(1);
+  }
+  if(nanosleep(0) < 0){
+    printf("%s: nanosleep(0) failed\n", s);
+    exit(1);
+  }
+}
+
+// the statistics device reports on the kernel's locks.
+void
+lockstats(char *s)
+{
+  static char buf[4096];
+  int i, n;
+
+  if((n = statistics(buf, sizeof(buf) - 1)) <= 0){
+    printf("%s: can't read statistics\n", s);
+    exit(1);
+  }
+  buf[n] = 0;
+  for(i = 0; i < n; i++)
+    if(memcmp(buf + i, "kmem [mcs]", 10) == 0)
+      return;
+  printf("%s: no kmem lock in statistics\n", s);
+  exit(1);
+}
+
+// the trap-free getpid(), uptime() and clock_gettime()
+// in ulib.c agree with the system calls.
+int sys_getpid(void);
+int sys_uptime(void);
+int sys_clock_gettime(uint64*);
+
+void
+vdatatest(char *s)
+{
+  uint64 t0, t1, t2;
+  int u0, u1;
+
+  if(getpid() != sys_getpid()){
+    printf("%s: getpid %d, want %d\n", s, getpid(), sys_getpid());
+    exit(1);
+  }
+  for(int i = 0; i < 3; i++){
+    u0 = uptime();
+    clock_gettime(&t0);
+    sys_clock_gettime(&t1);
+    clock_gettime(&t2);
+    u1 = sys_uptime();
+    if(u1 < u0 || u1 > uptime() || t1 < t0 || t2 < t1){
+      printf("%s: uptime %d/%d, clock %p %p %p\n", s, u0, u1, t0, t1, t2);
+      exit(1);
+    }
+    sleep(1);
+  }
+}
+
+// sysstat() counts each process's syscalls.
+// sysinfo() fills in freemem and nproc alone; sysinfo2()
+// fills in as much of the current struct as it is asked for.
+void
+sysinfo2test(char *s)
+{
+  struct sysinfo info;
+
+  memset(&info, 0xff, sizeof(info));
+  if(sysinfo(&info) < 0 || info.nproc == ~0L || info.version != ~0L){
+    printf("%s: sysinfo wrote past freemem and nproc\n", s);
+    exit(1);
+  }
+  memset(&info, 0xff, sizeof(info));
+  if(sysinfo2(&info, 3 * sizeof(uint64)) < 0 || info.version != SYSINFO_VERSION ||
+     info.size != ~0L){
+    printf("%s: sysinfo2 didn't stop at the size given\n", s);
+    exit(1);
+  }
+  if(sysinfo2(&info, sizeof(info)) < 0 || info.size != sizeof(info)){
+    printf("%s: sysinfo2 failed\n", s);
+    exit(1);
+  }
+  if(info.ncpu < 1 || info.totalmem < info.freemem || info.nrunnable > info.nproc){
+    printf("%s: sysinfo2 ncpu %d totalmem %d nrunnable %d\n", s,
+           (int)info.ncpu, (int)info.totalmem, (int)info.nrunnable);
+    exit(1);
+  }
+  if(info.bhit + info.bmiss == 0 || info.nread == 0){
+    printf("%s: sysinfo2 reports no disk activity\n", s);
+    exit(1);
+  }
+  if(sysinfo2((struct sysinfo*)0xeaeb0b5b00002f5e, sizeof(info)) != -1){
+    printf("%s: sysinfo2 succeeded with bad argument\n", s);
+    exit(1);
+  }
+}
+
+void
+sysstattest(char *s)
+{
+  static struct sysstat st[NSYSCALL];
+  int i, b, n;
+  uint64 n0;
+
+  if(sysstat(SS_PROC, getpid(), st) < 0){
+    printf("%s: sysstat failed\n", s);
+    exit(1);
+  }
+  n0 = st[SYS_sbrk].count;
+  for(i = 0; i < 100; i++)
+    sbrk(0);
+  if(sysstat(SS_PROC, getpid(), st) < 0 || st[SYS_sbrk].count != n0 + 100){
+    printf("%s: sbrk count %d, want %d\n", s, (int)st[SYS_sbrk].count, (int)n0 + 100);
+    exit(1);
+  }
+  n = 0;
+  for(b = 0; b < NHIST; b++)
+    n += st[SYS_sbrk].hist[b];
+  if(n != st[SYS_sbrk].count){
+    printf("%s: histogram holds %d calls\n", s, n);
+    exit(1);
+  }
+  if(sysstat(SS_ALL, 0, st) < 0 || st[SYS_sbrk].count < n0 + 100){
+    printf("%s: system-wide sbrk count too low\n", s);
+    exit(1);
+  }
+  if(sysstat(SS_PROC, -1, st) == 0 || sysstat(SS_CPU, NCPU, st) == 0){
+    printf("%s: sysstat of nothing succeeded\n", s);
+    exit(1);
+  }
+}
+
+// a fully buffered stream writes nothing until flushed,
+// and exit() flushes it.
+void
+stdiotest(char *s)
+{
+  struct stat st;
+  FILE *f;
+  char b[32];
+  int fd, pid, xstatus;
+
+  unlink("stdio-out");
+  if((fd = open("stdio-out", O_CREATE|O_WRONLY)) < 0 || (f = fdopen(fd, "w")) == 0){
+    printf("%s: cannot create stdio-out\n", s);
+    exit(1);
+  }
+  setvbuf(f, _IOFBF);
+  fileprintf(f, "%d %x %l\n", -7, 0xab, 0x123456789L);
+  if(fstat(fd, &st) < 0 || st.size != 0){
+    printf("%s: buffered output written early\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    fputs("child\n", f);
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0)
+    exit(xstatus);
+  fclose(f);
+
+  memset(b, 0, sizeof(b));
+  if((fd = open("stdio-out", O_RDONLY)) < 0 || read(fd, b, sizeof(b)-1) < 0){
+    printf("%s: cannot read stdio-out\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("stdio-out");
+  if(strcmp(b, "-7 AB 4886718345\nchild\n") != 0){
+    printf("%s: stdio-out holds \"%s\"\n", s, b);
+    exit(1);
+  }
+}
+
 // does exec return an error if the arguments
 // are larger than a page? or does it write
 // below the stack and wreck the instructions/data?
@@ -2849,10 +3465,23 @@ main(int argc, char *argv[])
     {fourfiles, "fourfiles"},
     {sharedfd, "sharedfd"},
     {dirtest, "dirtest"},
+    {readdirplustest, "readdirplus"},
+    {readdirplusrace, "readdirplusrace"},
+    {textbusy, "textbusy"},
     {exectest, "exectest"},
     {bigargtest, "bigargtest"},
     {bigwrite, "bigwrite"},
     {bsstest, "bsstest"},
+    {lazycopy, "lazycopy"},
+    {clonetest, "clonetest"},
+    {futextest, "futextest"},
+    {nanosleeptest, "nanosleep"},
+    {lockstats, "lockstats"},
+    {sysstattest, "sysstat"},
+    {sysinfo2test, "sysinfo2"},
+    {vdatatest, "vdata"},
+    {malloctest, "malloc"},
+    {stdiotest, "stdio"},
     {sbrkbasic, "sbrkbasic"},
     {sbrkmuch, "sbrkmuch"},
     {kernmem, "kernmem"},
@@ -2871,6 +3500,7 @@ main(int argc, char *argv[])
     {iputtest, "iput"},
     {mem, "mem"},
     {pipe1, "pipe1"},
+    {pipe2test, "pipe2"},
     {killstatus, "killstatus"},
     {preempt, "preempt"},
     {exitwait, "exitwait"},
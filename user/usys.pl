@@ -14,16 +14,47 @@ sub entry {
     print " ecall\n";
     print " ret\n";
 }
+
+# syscalls that user/ulib.c answers from the shared pages
+# (see VDATA in kernel/memlayout.h); their stubs are named
+# sys_<name>, for ulib.c to fall back on.
+sub ulibentry {
+    my $name = shift;
+    print "#ifdef LAB_PGTBL\n";
+    print ".global sys_$name\n";
+    print "sys_${name}:\n";
+    print "#else\n";
+    print ".global $name\n";
+    print "${name}:\n";
+    print "#endif\n";
+    print " li a7, SYS_${name}\n";
+    print " ecall\n";
+    print " ret\n";
+}
+
+# syscalls that user/stdio.c wraps to flush output first; the
+# stub is sys_<name>, and <name> is a weak alias for programs
+# linked without stdio.o (forktest).
+sub stdioentry {
+    my $name = shift;
+    print ".global sys_$name\n";
+    print ".weak $name\n";
+    print "sys_${name}:\n";
+    print "${name}:\n";
+    print " li a7, SYS_${name}\n";
+    print " ecall\n";
+    print " ret\n";
+}
 	
-entry("fork");
-entry("exit");
+stdioentry("fork");
+stdioentry("exit");
 entry("wait");
 entry("pipe");
 entry("read");
 entry("write");
 entry("close");
 entry("kill");
-entry("exec");
+stdioentry("exec");
 entry("open");
 entry("mknod");
 entry("unlink");
@@ -32,11 +63,25 @@ entry("link");
 entry("mkdir");
 entry("chdir");
 entry("dup");
-entry("getpid");
+ulibentry("getpid");
 entry("sbrk");
 entry("sleep");
-entry("uptime");
+ulibentry("uptime");
 entry("trace");
 entry("sysinfo");
 entry("connect");
 entry("pgaccess");
+stdioentry("spawn");
+entry("clone");
+entry("futex_wait");
+entry("futex_wake");
+entry("nanosleep");
+ulibentry("clock_gettime");
+entry("traceread");
+entry("sysstat");
+entry("prof");
+entry("profread");
+entry("getdents");
+entry("readdirplus");
+entry("pipe2");
+entry("sysinfo2");
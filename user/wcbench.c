@@ -0,0 +1,140 @@
+// wc throughput: time wc, wc -l, wc -w and wc -c on a corpus
+// file named rep times (files can't exceed about 268KB, so
+// this is how the input reaches several MB), next to the old
+// wc loop (512-byte reads, strchr() per byte) run in-process.
+//
+// usage: wcbench [-r rep]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define CORPUS "wcbench.txt"
+#define KB 256
+#define MAXREP 29       // with wc and a flag, within MAXARG
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+char *flags[] = { 0, "-l", "-w", "-c" };
+
+void
+corpus(void)
+{
+  static char line[81];
+  uint seed = 1;
+  int fd, i, j;
+
+  if((fd = open(CORPUS, O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+    fprintf(2, "wcbench: cannot create %s\n", CORPUS);
+    exit(1);
+  }
+  for(i = 0; i < KB * 1024 / sizeof(line); i++){
+    for(j = 0; j < sizeof(line) - 1; j++){
+      seed = seed * 1103515245 + 12345;
+      line[j] = (seed >> 8) % 6 == 0 ? ' ' : 'a' + (seed >> 12) % 26;
+    }
+    line[j] = '\n';
+    if(write(fd, line, sizeof(line)) != sizeof(line)){
+      fprintf(2, "wcbench: write failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+}
+
+// the old wc loop.
+int
+oldwc(int fd)
+{
+  static char buf[512];
+  int i, n;
+  int l, w, c, inword;
+
+  l = w = c = 0;
+  inword = 0;
+  while((n = read(fd, buf, sizeof(buf))) > 0){
+    for(i=0; i<n; i++){
+      c++;
+      if(buf[i] == '\n')
+        l++;
+      if(strchr(" \r\t\n\v", buf[i]))
+        inword = 0;
+      else if(!inword){
+        w++;
+        inword = 1;
+      }
+    }
+  }
+  return l + w + c;
+}
+
+uint64
+now(void)
+{
+  uint64 t;
+
+  clock_gettime(&t);
+  return t;
+}
+
+void
+report(char *what, int rep, uint64 t)
+{
+  printf("%s: %l KB/s\n", what, persec((uint64)rep * KB, t));
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *args[MAXREP + 3];
+  int fdmap[3];
+  int i, j, n, rep, fd;
+  uint64 t;
+
+  rep = 16;
+  if(argc == 3 && strcmp(argv[1], "-r") == 0)
+    rep = atoi(argv[2]);
+  else if(argc != 1)
+    rep = 0;
+  if(rep <= 0 || rep > MAXREP){
+    fprintf(2, "usage: wcbench [-r rep]\n");
+    exit(1);
+  }
+
+  corpus();
+  printf("wcbench: %d KB\n", rep * KB);
+
+  t = now();
+  for(i = 0; i < rep; i++){
+    if((fd = open(CORPUS, O_RDONLY)) < 0){
+      fprintf(2, "wcbench: cannot open %s\n", CORPUS);
+      exit(1);
+    }
+    oldwc(fd);
+    close(fd);
+  }
+  report("old wc", rep, now() - t);
+
+  // wc's output goes nowhere.
+  fdmap[0] = 0;
+  fdmap[1] = -1;
+  fdmap[2] = 2;
+  for(i = 0; i < NELEM(flags); i++){
+    n = 0;
+    args[n++] = "wc";
+    if(flags[i])
+      args[n++] = flags[i];
+    for(j = 0; j < rep; j++)
+      args[n++] = CORPUS;
+    args[n] = 0;
+    t = now();
+    if(spawn("wc", args, fdmap) < 0){
+      fprintf(2, "wcbench: cannot run wc\n");
+      exit(1);
+    }
+    wait(0);
+    report(flags[i] ? flags[i] : "wc", rep, now() - t);
+  }
+  unlink(CORPUS);
+  exit(0);
+}
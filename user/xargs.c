@@ -1,35 +1,139 @@
+// xargs: run a command with arguments read from stdin.
+//
+// usage: xargs [-n max] [-P procs] command [arg ...]
+//
+// Reads whitespace-separated words from stdin as it goes and
+// runs command with up to max of them (default 1) after the
+// given arguments, keeping up to procs commands (default 1)
+// running at once. Exits 1 if any command failed.
+
 #include "kernel/types.h"
+#include "kernel/param.h"
 #include "user/user.h"
 
-char *arg[100];
-char buf[100];
+#define MAXWORD 512
+
+char buf[4096];
+int nbuf, off, eof;
+
+char *cmd[MAXARG];
+char words[MAXARG][MAXWORD];
+int nrun, failed;
+
+// the next byte of stdin, or -1 at the end.
+int
+next(void)
+{
+  if(off == nbuf){
+    if(eof || (nbuf = read(0, buf, sizeof(buf))) <= 0){
+      eof = 1;
+      nbuf = off = 0;
+      return -1;
+    }
+    off = 0;
+  }
+  return (uchar)buf[off++];
+}
+
+int
+space(int c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
 
-int main(int argc, char *argv[]) {
-    for(int i = 0; i < argc - 1; i++) {
-        arg[i] = argv[i+1];
-    }   
-    arg[argc] = 0; 
-    memset(buf, '\0', sizeof buf);
-    while(read(0, buf + strlen(buf), sizeof buf)) ; 
-    int len = strlen(buf);
+// read the next word into w. returns 0 at the end of input.
+int
+word(char *w)
+{
+  int c, n;
 
-    for(int i = 0; i < len; i++) {
-        if(buf[i] == ' ' || buf[i] == '\n') buf[i] = '\0';
+  while((c = next()) >= 0 && space(c))
+    ;
+  for(n = 0; c >= 0 && !space(c); c = next()){
+    if(n == MAXWORD - 1){
+      fprintf(2, "xargs: argument too long\n");
+      exit(1);
     }
-    char *p = buf;
-
-    while(p-buf < len && *p == '\0') p++;
-    while(p-buf < len) {
-        if(fork() == 0) {
-            arg[argc-1] = p;
-            exec(arg[0], arg);
-
-            fprintf(2, "exec error\n");
-            exit(1);
-        }
-        while(p-buf < len && *p != '\0') p++;
-        while(p-buf < len && *p == '\0') p++;
+    w[n++] = c;
+  }
+  w[n] = 0;
+  return n > 0;
+}
+
+// wait for a command to finish.
+void
+reap(void)
+{
+  int status;
+
+  if(wait(&status) < 0)
+    return;
+  nrun--;
+  if(status != 0)
+    failed = 1;
+}
+
+void
+run(int procs)
+{
+  while(nrun >= procs)
+    reap();
+  if(spawn(cmd[0], cmd, 0) < 0){
+    fprintf(2, "xargs: cannot run %s\n", cmd[0]);
+    failed = 1;
+    return;
+  }
+  nrun++;
+}
+
+void
+usage(void)
+{
+  fprintf(2, "usage: xargs [-n max] [-P procs] command [arg ...]\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, max, procs, nfixed;
+
+  max = procs = 1;
+  for(i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2){
+    if(strcmp(argv[i], "-n") == 0)
+      max = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-P") == 0)
+      procs = atoi(argv[i+1]);
+    else
+      usage();
+  }
+  if(i >= argc || max <= 0 || procs <= 0)
+    usage();
+
+  for(nfixed = 0; i < argc; i++){
+    if(nfixed >= MAXARG - 2){
+      fprintf(2, "xargs: too many arguments\n");
+      exit(1);
+    }
+    cmd[nfixed++] = argv[i];
+  }
+  if(max > MAXARG - 1 - nfixed)
+    max = MAXARG - 1 - nfixed;
+
+  n = 0;
+  while(word(words[n])){
+    cmd[nfixed + n] = words[n];
+    if(++n == max){
+      cmd[nfixed + n] = 0;
+      run(procs);
+      n = 0;
     }
-    memset(buf, '\0', sizeof buf);
-    exit(0);
-}
\ No newline at end of file
+  }
+  if(n > 0){
+    cmd[nfixed + n] = 0;
+    run(procs);
+  }
+  while(nrun > 0)
+    reap();
+  exit(failed);
+}
@@ -0,0 +1,83 @@
+// xargs benchmark: feed thousands of lines to xargs echo with
+// several -n and -P settings, and time each run.
+//
+// usage: xargsbench [-l lines]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define INPUT "xargsbench.in"
+
+char *settings[][4] = {
+  { "-n", "1", "-P", "1" },
+  { "-n", "1", "-P", "4" },
+  { "-n", "8", "-P", "1" },
+  { "-n", "8", "-P", "4" },
+  { "-n", "24", "-P", "4" },
+};
+
+void
+input(int lines)
+{
+  FILE *f;
+  int fd, i;
+
+  if((fd = open(INPUT, O_CREATE|O_TRUNC|O_WRONLY)) < 0 || (f = fdopen(fd, "w")) == 0){
+    fprintf(2, "xargsbench: cannot create %s\n", INPUT);
+    exit(1);
+  }
+  for(i = 0; i < lines; i++)
+    fileprintf(f, "line%d\n", i);
+  fclose(f);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *args[8];
+  int fdmap[3];
+  int i, j, lines, status;
+  uint64 t0, t1;
+
+  lines = 2000;
+  if(argc == 3 && strcmp(argv[1], "-l") == 0)
+    lines = atoi(argv[2]);
+  else if(argc != 1)
+    lines = 0;
+  if(lines <= 0){
+    fprintf(2, "usage: xargsbench [-l lines]\n");
+    exit(1);
+  }
+
+  input(lines);
+  printf("xargsbench: xargs echo over %d lines\n", lines);
+  // echo's output goes nowhere.
+  fdmap[1] = -1;
+  fdmap[2] = 2;
+  for(i = 0; i < sizeof(settings) / sizeof(settings[0]); i++){
+    if((fdmap[0] = open(INPUT, O_RDONLY)) < 0){
+      fprintf(2, "xargsbench: cannot open %s\n", INPUT);
+      exit(1);
+    }
+    args[0] = "xargs";
+    for(j = 0; j < 4; j++)
+      args[j+1] = settings[i][j];
+    args[5] = "echo";
+    args[6] = 0;
+    clock_gettime(&t0);
+    if(spawn("xargs", args, fdmap) < 0){
+      fprintf(2, "xargsbench: cannot run xargs\n");
+      exit(1);
+    }
+    wait(&status);
+    clock_gettime(&t1);
+    close(fdmap[0]);
+    printf("%s %s %s %s: %l ms, %l lines/s%s\n", args[1], args[2], args[3], args[4],
+           (t1 - t0) / 1000000, persec(lines, t1 - t0),
+           status ? " (failed)" : "");
+  }
+  unlink(INPUT);
+  exit(0);
+}